@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SlateBrush.h"
+#include "Engine/CanvasRenderTarget2D.h"
+#include "MapIconAtlas.generated.h"
+
+/* One page of a UMapIconAtlas, redraws its icons whenever the render target is updated*/
+UCLASS()
+class MAPPING_API UMapIconAtlasPage : public UCanvasRenderTarget2D
+{
+	GENERATED_BODY()
+public:
+	void Init(class UMapIconAtlas* InAtlas, int32 InPageIndex);
+
+private:
+	UFUNCTION()
+	void DrawIcons(UCanvas* Canvas, int32 Width, int32 Height);
+
+	TWeakObjectPtr<class UMapIconAtlas> Atlas;
+	int32 PageIndex;
+};
+
+/**
+Packs marker icon brushes into shared canvas render target pages at the size they are drawn, so markers with different
+icon textures still batch into one draw call per page. Icons are drawn into the page on the GPU, which samples the source
+texture's mips for the downscale and works in cooked builds where source pixels are no longer on the CPU.
+The outer must be in a world, it is used as the world context for the pages.
+**/
+UCLASS()
+class MAPPING_API UMapIconAtlas : public UObject
+{
+	GENERATED_BODY()
+public:
+	UMapIconAtlas(const FObjectInitializer& ObjectInitializer);
+
+	/*Pack an image brush with a texture resource and write a brush that draws it from the atlas. Returns false for brushes that can not be atlased*/
+	bool AddIcon(const FSlateBrush& Source, FSlateBrush& OutAtlasBrush);
+
+	/*Redraw pages that received icons since the last flush*/
+	void Flush();
+
+	FORCEINLINE int32 NumPages() const { return Pages.Num(); }
+
+	/*Memory of the atlas pages and of the distinct source textures they replace*/
+	SIZE_T GetPageMemory() const;
+	SIZE_T GetSourceTextureMemory() const;
+	int32 NumSourceTextures() const;
+
+	/*Side of a page in texels*/
+	UPROPERTY(EditAnywhere, Category = "MapIconAtlas", meta = (ClampMin = "64", ClampMax = "4096"))
+	int32 PageSize;
+
+	/*Texels per Slate unit of icon size, the largest zoom icons are drawn at. Icons are never packed above their source resolution*/
+	UPROPERTY(EditAnywhere, Category = "MapIconAtlas", meta = (ClampMin = "0.25"))
+	float IconScale;
+
+	/*Empty texels around each icon so filtering never reads a neighbour*/
+	UPROPERTY(EditAnywhere, Category = "MapIconAtlas", meta = (ClampMin = "0"))
+	int32 Padding;
+
+private:
+	struct FIcon
+	{
+		UTexture* Texture;
+		FBox2D SourceUV;
+		int32 Page;
+		FIntRect Rect;
+	};
+
+	/*Current row of a page, icons are placed left to right and a new row starts under the tallest icon*/
+	struct FShelf
+	{
+		int32 Y;
+		int32 Height;
+		int32 CursorX;
+	};
+
+	friend class UMapIconAtlasPage;
+
+	bool Allocate(const FIntPoint& Size, int32& OutPage, FIntRect& OutRect);
+	void DrawPage(UCanvas* Canvas, int32 Page) const;
+	void UpdateStats() const;
+
+	UPROPERTY(Transient)
+	TArray<UMapIconAtlasPage*> Pages;
+
+	/*Source textures kept alive for redrawing pages*/
+	UPROPERTY(Transient)
+	TArray<UTexture*> SourceTextures;
+
+	TArray<FIcon> Icons;
+	TArray<FShelf> Shelves;
+	TArray<bool> DirtyPages;
+};
\ No newline at end of file
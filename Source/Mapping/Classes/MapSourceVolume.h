@@ -3,6 +3,7 @@
 #pragma once
 
 #include "GameFramework/Volume.h"
+#include "MapExplorationGrid.h"
 #include "MapSourceVolume.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnActorEnter, class AMapSourceVolume*, Volume, AActor*, EnteredActor, UPrimitiveComponent*, EnteredComponent);
@@ -62,6 +63,35 @@ public:
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const;
 	/*End Actor Interface*/
 
+	/* Reveal the area around an Actor as it moves, in addition to the tracked actor*/
+	UFUNCTION(BlueprintCallable, Category = "MapSourceVolume|Exploration")
+	void AddExplorationRevealer(AActor* Revealer);
+
+	UFUNCTION(BlueprintCallable, Category = "MapSourceVolume|Exploration")
+	void RemoveExplorationRevealer(AActor* Revealer);
+
+	/* Reveal the area around a world location*/
+	UFUNCTION(BlueprintCallable, Category = "MapSourceVolume|Exploration")
+	void RevealExplorationAt(const FVector& WorldLocation);
+
+	/* Compact copy of the explored area for save games*/
+	UFUNCTION(BlueprintCallable, Category = "MapSourceVolume|Exploration")
+	void SaveExploration(TArray<uint8>& OutData);
+
+	/* Restore an explored area written by SaveExploration, fails if the volume's grid changed size since*/
+	UFUNCTION(BlueprintCallable, Category = "MapSourceVolume|Exploration")
+	bool LoadExploration(const TArray<uint8>& Data);
+
+	/* Mask texture of the explored area, opaque where unexplored*/
+	FORCEINLINE UTexture2D* GetExplorationTexture() const { return ExplorationTexture; }
+
+	FORCEINLINE const FMapExplorationGrid& GetExplorationGrid() const { return ExplorationGrid; }
+
+	FORCEINLINE const FLinearColor& GetExplorationFogColor() const { return ExplorationFogColor; }
+
+	/* World space corner of the exploration grid at cell (0, 0) and the world space edges along the grid X and Y axes*/
+	void GetExplorationQuad(FVector& OutOrigin, FVector& OutAxisX, FVector& OutAxisY) const;
+
 	/** Used to synchronize the DrawFrustumComponent with the SceneCaptureComponentMap settings. */
 	void UpdateDrawFrustum();
 
@@ -102,6 +132,28 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MapSourceVolume")
 	bool bAutoIgnoreActorsWithSceneMapComponents;
 
+	/* Track which parts of the volume have been explored and provide a fog mask for maps*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MapSourceVolume|Exploration")
+	bool bEnableExploration;
+
+	/* World size of one exploration cell. The grid is capped at 4096 cells per side*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MapSourceVolume|Exploration", meta = (ClampMin = "1", EditCondition = "bEnableExploration"))
+	float ExplorationCellSize;
+
+	/* World distance around the tracked actor and revealers that becomes explored*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MapSourceVolume|Exploration", meta = (ClampMin = "0", EditCondition = "bEnableExploration"))
+	float ExplorationRevealRadius;
+
+	/* Color of unexplored areas on the map*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MapSourceVolume|Exploration", meta = (EditCondition = "bEnableExploration"))
+	FLinearColor ExplorationFogColor;
+
+	/* Reveal around revealers that moved to another cell and push the changed part of the grid to the texture*/
+	void UpdateExploration();
+
+	/* Copy the dirty rectangle of the grid into the mask texture*/
+	void FlushExplorationTexture();
+
 private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (AllowPrivateAccess = "true"))
 	class USceneCaptureComponentMap* MapCaptureComponent;
@@ -118,6 +170,23 @@ private:
 	UPROPERTY(Replicated, BlueprintReadOnly, VisibleAnywhere, Category = "MapSourceVolume", Meta = (AllowPrivateAccess = "true"))
 	TArray<class USceneMapComponent*> ContainedMapComponents;
 
+	UPROPERTY(Transient)
+	UTexture2D* ExplorationTexture;
+
+	FMapExplorationGrid ExplorationGrid;
+
+	/* Local space box the exploration grid covers*/
+	FBox ExplorationBounds;
+
+	TArray<TWeakObjectPtr<AActor>> ExplorationRevealers;
+
+	/* Cell each revealer last revealed from, parallel to ExplorationRevealers*/
+	TArray<FIntPoint> RevealerCells;
+	FIntPoint TrackedActorCell;
+
+	FIntPoint WorldToExplorationCell(const FVector& WorldLocation) const;
+	void InitExploration();
+
 	UFUNCTION()
 	void OnComponentEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
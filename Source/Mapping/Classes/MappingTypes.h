@@ -2,4 +2,66 @@
 
 #pragma once
 
-#include "InputCoreTypes.h"
\ No newline at end of file
+#include "InputCoreTypes.h"
+#include "MappingTypes.generated.h"
+
+/* Snapshot of the World to Texture projection of a SceneCaptureComponentMap, so many locations can be projected without rebuilding the matrix*/
+struct MAPPING_API FMapProjection
+{
+	FMatrix ViewProjectionMatrix;
+	FIntRect ViewRect;
+	FVector2D ViewToTextureScale;
+
+	FMapProjection()
+		: ViewProjectionMatrix(FMatrix::Identity)
+		, ViewRect(0, 0, 0, 0)
+		, ViewToTextureScale(1.0f, 1.0f)
+	{}
+
+	/*Project a world location to the texture, returns false if the location is behind the capture*/
+	bool Project(const FVector& WorldLocation, FVector& OutTextureLocation) const;
+
+	/*Project many world locations with the view rect and texture scale folded into one multiply add. Locations behind the capture project to zero*/
+	void ProjectBatch(const FVector* WorldLocations, int32 Count, FVector2D* OutTextureLocations) const;
+
+	/*World location that projects to a texture location, on the near plane of the capture*/
+	FVector Deproject(const FVector2D& TextureLocation) const;
+
+	bool Equals(const FMapProjection& Other) const
+	{
+		return ViewRect == Other.ViewRect &&
+			ViewToTextureScale.Equals(Other.ViewToTextureScale) &&
+			ViewProjectionMatrix.Equals(Other.ViewProjectionMatrix, 0.0f);
+	}
+};
+
+/* How often a SceneMapComponent is sampled for the map. Auto derives the tier from mobility, distance to the tracked actor and priority*/
+UENUM(BlueprintType)
+enum class EMapMarkerUpdateTier : uint8
+{
+	Auto,
+	/*Sampled once when registered*/
+	Static,
+	/*Sampled once every SlowUpdateInterval frames*/
+	Slow,
+	/*Sampled once every NormalUpdateInterval frames*/
+	Normal,
+	EveryFrame
+};
+
+/* Map layers a SceneMapComponent can belong to. Values are bit indices into USceneMapComponent::MapCategories*/
+UENUM(BlueprintType, meta = (Bitflags))
+enum class EMapMarkerCategory : uint8
+{
+	Default,
+	Enemy,
+	Ally,
+	Loot,
+	Objective
+};
+
+/* Mask with only the bit of the given category set*/
+FORCEINLINE uint32 MapCategoryToMask(EMapMarkerCategory Category)
+{
+	return 1u << (uint32)Category;
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 #pragma once
 
 #include "Components/SceneCaptureComponent2D.h"
+#include "MapMarkerStore.h"
+#include "MapHeatmap.h"
 #include "SceneCaptureComponentMap.generated.h"
 
 /* A Scene capture component map is used to create an image and do management of map rendered objects. It also includes the math for figuring out the World to Map relationship of objects.*/
@@ -43,8 +45,45 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SceneCaptureComponentMap")
 	void GoToWorldPosition(const FVector& WorldLocation, FVector ClampAxis = FVector(1.0f, 1.0f, 0.0f));
 
+	/*Build a snapshot of the current World to Texture projection*/
+	FMapProjection GetMapProjection() const;
+
+	/*Begin sampling a SceneMapComponent for the map according to its update tier and show it in the views of ViewMask. Registrations are reference counted*/
+	void RegisterMarker(class USceneMapComponent* Component, uint32 ViewMask = 0);
+
+	/*Release a registration made with RegisterMarker, also when the component has been destroyed since*/
+	void UnregisterMarker(const TWeakObjectPtr<class USceneMapComponent>& Component, uint32 ViewMask = 0);
+
+	/*Reserve a view bit for a widget drawing markers of this capture. Returns 0 when all 32 views are taken*/
+	uint32 AcquireMarkerView();
+	void ReleaseMarkerView(uint32 ViewMask);
+
+	/*Packed per frame state of every registered marker. Widgets read markers from here rather than from the components*/
+	FORCEINLINE const FMapMarkerStore& GetMarkerStore() const { return MarkerStore; }
+
+	/*The Actor used as the origin for distance based update tiers. When null the capture location is used*/
+	void SetMarkerFocusActor(AActor* Actor);
+
+	/*Create a heatmap bound to the current texture space of the capture, or clear and rebind an existing one. CellSize is in texels*/
+	UFUNCTION(BlueprintCallable, Category = "SceneCaptureComponentMap|Heatmap")
+	void CreateHeatmap(FName Heatmap, int32 CellSize = 4);
+
+	/*Bin a batch of world positions into a heatmap*/
+	UFUNCTION(BlueprintCallable, Category = "SceneCaptureComponentMap|Heatmap")
+	void AddHeatmapSamples(FName Heatmap, const TArray<FVector>& WorldLocations);
+
+	/*Blur a heatmap and refresh its overlay texture*/
+	UFUNCTION(BlueprintCallable, Category = "SceneCaptureComponentMap|Heatmap")
+	void UpdateHeatmapTexture(FName Heatmap, float BlurRadius = 2.0f);
+
+	UFUNCTION(BlueprintCallable, Category = "SceneCaptureComponentMap|Heatmap")
+	void RemoveHeatmap(FName Heatmap);
+
+	TSharedPtr<FMapHeatmap> FindHeatmap(FName Heatmap) const;
+
 	/*Component Interface*/
 	virtual void Activate(bool bReset) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	/*End Component Interface*/
 
 protected:
@@ -67,4 +106,56 @@ protected:
 	/*The texture parameter name of the instanced dynamic material*/
 	UPROPERTY(EditDefaultsOnly, Category = "SceneCaptureComponentMap")
 	FName MaterialParameterName;
+
+	/*Auto tier markers closer than this to the focus actor are sampled every frame*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers")
+	float EveryFrameUpdateDistance;
+
+	/*Auto tier markers closer than this to the focus actor use the Normal tier, further ones the Slow tier*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers")
+	float NormalUpdateDistance;
+
+	/*Number of frames a Normal tier marker is sampled across*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers", meta = (ClampMin = "1"))
+	int32 NormalUpdateInterval;
+
+	/*Number of frames a Slow tier marker is sampled across*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers", meta = (ClampMin = "1"))
+	int32 SlowUpdateInterval;
+
+	/*Seconds smoothed markers are displayed behind their newest sample, so they interpolate between replicated positions*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers", meta = (ClampMin = "0"))
+	float MarkerInterpolationDelay;
+
+	/*Seconds smoothed markers may be dead reckoned past their newest sample before they stop*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers", meta = (ClampMin = "0"))
+	float MaxMarkerExtrapolationTime;
+
+	/*Categories whose icons turn with their component. Markers only in other categories keep a fixed icon and never read their rotation*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SceneCaptureComponentMap|Markers", meta = (Bitmask, BitmaskEnum = "EMapMarkerCategory"))
+	int32 RotatingMarkerCategories;
+
+	/*Pack marker icons into atlas pages at their drawn size so markers batch into a draw call per page*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SceneCaptureComponentMap|Markers")
+	bool bUseIconAtlas;
+
+	/*Texels per Slate unit icons are packed at. Icons grow with the map zoom, so this matches the default largest zoom of a map panel
+	and icons are never drawn magnified. Raise it with the zoom range or for high DPI displays, icons stay capped at their source resolution*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SceneCaptureComponentMap|Markers", meta = (ClampMin = "0.25", EditCondition = "bUseIconAtlas"))
+	float IconAtlasScale;
+
+	UPROPERTY(Transient)
+	class UMapIconAtlas* IconAtlas;
+
+private:
+	/*Gather the projection, focus and tier settings for a marker store update*/
+	FMapMarkerUpdateContext GetMarkerUpdateContext() const;
+
+	/*Move brushes the store added from FirstBrushId on into the icon atlas*/
+	void AtlasNewBrushes(int32 FirstBrushId);
+
+	FMapMarkerStore MarkerStore;
+	TWeakObjectPtr<AActor> MarkerFocusActor;
+	uint32 UsedMarkerViews;
+	TMap<FName, TSharedPtr<FMapHeatmap>> Heatmaps;
 };
\ No newline at end of file
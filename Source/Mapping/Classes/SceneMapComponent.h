@@ -4,6 +4,7 @@
 
 #include "Components/SceneComponent.h"
 #include "SlateBrush.h"
+#include "MappingTypes.h"
 #include "SceneMapComponent.generated.h"
 
 /**
@@ -26,6 +27,49 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent")
 	FSlateBrush MapIcon;
 
+	/*Text drawn next to the icon, placed so labels do not overlap. Read when the map lays labels out, leave empty for no label*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Label")
+	FText MapLabel;
+
+	/*Labels are placed from the highest priority down, so when space or the label budget runs out the lowest are dropped*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Label")
+	int32 MapLabelPriority;
+
+	/*How often the map samples this component. Auto picks a tier from mobility, distance to the tracked actor and UpdatePriority*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent")
+	EMapMarkerUpdateTier UpdateTier;
+
+	/*Used by the Auto tier, each point promotes the component one tier closer to EveryFrame. Two points take Slow to EveryFrame*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent", meta = (ClampMin = "0", ClampMax = "2"))
+	int32 UpdatePriority;
+
+	/*Map layers this component belongs to. A map shows the component if any of these are active on it*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent", meta = (Bitmask, BitmaskEnum = "EMapMarkerCategory"))
+	int32 MapCategories;
+
+	/*Draw this component with a full widget from SMap::OnGenerateChildIcon instead of the batched marker layer. Costs a widget per map*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent")
+	bool bUseIconWidget;
+
+	/*Interpolate the map location between sampled positions instead of jumping. Use for replicated actors with a low net update frequency*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent")
+	bool bSmoothMapLocation;
+
+	/*Record a breadcrumb trail of this component on the map*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Trail")
+	bool bRecordMapTrail;
+
+	/*Points kept in the trail, older points are dropped. Capped at FMapTrail::MaxCapacity*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Trail", meta = (ClampMin = "2", ClampMax = "1024", EditCondition = "bRecordMapTrail"))
+	int32 MaxMapTrailPoints;
+
+	/*World distance the component must move before the trail takes another point*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Trail", meta = (ClampMin = "0", EditCondition = "bRecordMapTrail"))
+	float MapTrailSampleDistance;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SceneMapComponent|Trail", meta = (EditCondition = "bRecordMapTrail"))
+	FLinearColor MapTrailColor;
+
 protected:
 	/*Internal overridable implementation of ClampToMapEdge*/
 	UFUNCTION(BlueprintNativeEvent, Category = "SceneMapComponent")
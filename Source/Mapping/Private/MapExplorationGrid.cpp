@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapExplorationGrid.h"
+
+FMapExplorationGrid::FMapExplorationGrid()
+	: Width(0)
+	, Height(0)
+	, WordsPerRow(0)
+{
+}
+
+void FMapExplorationGrid::Init(int32 InWidth, int32 InHeight)
+{
+	Width = FMath::Max(InWidth, 0);
+	Height = FMath::Max(InHeight, 0);
+	WordsPerRow = FMath::DivideAndRoundUp(Width, 64);
+	Words.Reset();
+	Words.SetNumZeroed(WordsPerRow * Height);
+
+	DirtyRects.Reset();
+	MarkDirty(FIntRect(0, 0, Width, Height));
+}
+
+bool FMapExplorationGrid::Reveal(const FIntPoint& Center, int32 Radius)
+{
+	//One dirty rect per reveal, around the spans that actually changed
+	FIntRect Changed(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+	const int32 MinY = FMath::Max(Center.Y - Radius, 0);
+	const int32 MaxY = FMath::Min(Center.Y + Radius, Height - 1);
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		const int32 DeltaY = Y - Center.Y;
+		const int32 HalfSpan = FMath::FloorToInt(FMath::Sqrt((float)(Radius * Radius - DeltaY * DeltaY)));
+		const int32 X0 = FMath::Max(Center.X - HalfSpan, 0);
+		const int32 X1 = FMath::Min(Center.X + HalfSpan, Width - 1);
+		if (X0 <= X1 && SetSpan(Y, X0, X1))
+		{
+			Changed.Min = Changed.Min.ComponentMin(FIntPoint(X0, Y));
+			Changed.Max = Changed.Max.ComponentMax(FIntPoint(X1 + 1, Y + 1));
+		}
+	}
+	if (Changed.Min.X > Changed.Max.X)
+	{
+		return false;
+	}
+	MarkDirty(Changed);
+	return true;
+}
+
+bool FMapExplorationGrid::SetSpan(int32 Y, int32 X0, int32 X1)
+{
+	uint64* Row = Words.GetData() + Y * WordsPerRow;
+	const int32 FirstWord = X0 >> 6;
+	const int32 LastWord = X1 >> 6;
+
+	uint64 Changed = 0;
+	for (int32 Word = FirstWord; Word <= LastWord; ++Word)
+	{
+		uint64 Mask = ~0ull;
+		if (Word == FirstWord)
+		{
+			Mask &= ~0ull << (X0 & 63);
+		}
+		if (Word == LastWord)
+		{
+			Mask &= ~0ull >> (63 - (X1 & 63));
+		}
+		Changed |= Mask & ~Row[Word];
+		Row[Word] |= Mask;
+	}
+	return Changed != 0;
+}
+
+static FORCEINLINE bool RectsTouch(const FIntRect& A, const FIntRect& B)
+{
+	return A.Min.X <= B.Max.X && B.Min.X <= A.Max.X && A.Min.Y <= B.Max.Y && B.Min.Y <= A.Max.Y;
+}
+
+static FORCEINLINE int64 RectArea(const FIntRect& Rect)
+{
+	return (int64)Rect.Width() * Rect.Height();
+}
+
+static FORCEINLINE FIntRect RectUnion(const FIntRect& A, const FIntRect& B)
+{
+	return FIntRect(A.Min.ComponentMin(B.Min), A.Max.ComponentMax(B.Max));
+}
+
+void FMapExplorationGrid::MarkDirty(FIntRect Rect)
+{
+	//Absorb every rect the new one touches, the grown rect may then touch more. Over the cap the cheapest union is taken instead
+	for (;;)
+	{
+		int32 MergeIndex = INDEX_NONE;
+		for (int32 Index = 0; Index < DirtyRects.Num(); ++Index)
+		{
+			if (RectsTouch(DirtyRects[Index], Rect))
+			{
+				MergeIndex = Index;
+				break;
+			}
+		}
+		if (MergeIndex == INDEX_NONE && DirtyRects.Num() >= MaxDirtyRects)
+		{
+			int64 LeastWaste = MAX_int64;
+			for (int32 Index = 0; Index < DirtyRects.Num(); ++Index)
+			{
+				const int64 Waste = RectArea(RectUnion(DirtyRects[Index], Rect)) - RectArea(DirtyRects[Index]) - RectArea(Rect);
+				if (Waste < LeastWaste)
+				{
+					LeastWaste = Waste;
+					MergeIndex = Index;
+				}
+			}
+		}
+		if (MergeIndex == INDEX_NONE)
+		{
+			break;
+		}
+		Rect = RectUnion(Rect, DirtyRects[MergeIndex]);
+		DirtyRects.RemoveAtSwap(MergeIndex, 1, false);
+	}
+	DirtyRects.Add(Rect);
+}
+
+void FMapExplorationGrid::ClearDirty()
+{
+	DirtyRects.Reset();
+}
+
+void FMapExplorationGrid::ExpandRect(const FIntRect& Rect, uint8* OutAlpha, int32 BytesPerCell, int32 Pitch) const
+{
+	for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+	{
+		const uint64* Row = Words.GetData() + Y * WordsPerRow;
+		uint8* Out = OutAlpha + (Y - Rect.Min.Y) * Pitch;
+		for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X, Out += BytesPerCell)
+		{
+			*Out = ((Row[X >> 6] >> (X & 63)) & 1) ? 0 : 255;
+		}
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FMapExplorationGrid& Grid)
+{
+	int32 Width = Grid.Width;
+	int32 Height = Grid.Height;
+	Ar << Width << Height;
+
+	int32 NumRuns = 0;
+	if (Ar.IsLoading())
+	{
+		Grid.Init(Width, Height);
+		Ar << NumRuns;
+
+		int32 WordIndex = 0;
+		for (int32 Run = 0; Run < NumRuns && !Ar.IsError(); ++Run)
+		{
+			int32 RunLength = 0;
+			uint64 Word = 0;
+			Ar << RunLength << Word;
+
+			RunLength = FMath::Clamp(RunLength, 0, Grid.Words.Num() - WordIndex);
+			for (int32 Offset = 0; Offset < RunLength; ++Offset)
+			{
+				Grid.Words[WordIndex++] = Word;
+			}
+		}
+	}
+	else
+	{
+		for (int32 WordIndex = 0; WordIndex < Grid.Words.Num(); ++NumRuns)
+		{
+			const int32 RunStart = WordIndex;
+			while (WordIndex < Grid.Words.Num() && Grid.Words[WordIndex] == Grid.Words[RunStart])
+			{
+				++WordIndex;
+			}
+		}
+		Ar << NumRuns;
+
+		for (int32 WordIndex = 0; WordIndex < Grid.Words.Num();)
+		{
+			const int32 RunStart = WordIndex;
+			while (WordIndex < Grid.Words.Num() && Grid.Words[WordIndex] == Grid.Words[RunStart])
+			{
+				++WordIndex;
+			}
+			int32 RunLength = WordIndex - RunStart;
+			uint64 Word = Grid.Words[RunStart];
+			Ar << RunLength << Word;
+		}
+	}
+	return Ar;
+}
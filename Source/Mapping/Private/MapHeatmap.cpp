@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapHeatmap.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Heatmap Accumulate"), STAT_MapHeatmapAccumulate, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Heatmap Update Texture"), STAT_MapHeatmapUpdateTexture, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Heatmap Samples"), STAT_MapHeatmapSamples, STATGROUP_Mapping);
+
+/*Locations projected at a time on the stack of a binning task*/
+static const int32 HeatmapProjectBatch = 256;
+
+FMapHeatmap::FMapHeatmap()
+	: ColdColor(0.0f, 0.0f, 1.0f, 0.0f)
+	, HotColor(1.0f, 0.0f, 0.0f, 0.8f)
+	, TextureSize(FVector2D::ZeroVector)
+	, Resolution(0, 0)
+	, NumSamples(0)
+	, Texture(nullptr)
+{
+}
+
+void FMapHeatmap::Bind(const FMapProjection& InProjection, const FVector2D& InTextureSize, const FIntPoint& InResolution)
+{
+	Projection = InProjection;
+	TextureSize = InTextureSize;
+	Resolution = FIntPoint(FMath::Max(InResolution.X, 1), FMath::Max(InResolution.Y, 1));
+	Partials.Reset();
+	Reset();
+}
+
+void FMapHeatmap::Reset()
+{
+	Counts.Reset();
+	Counts.SetNumZeroed(Resolution.X * Resolution.Y);
+	NumSamples = 0;
+}
+
+void FMapHeatmap::AddSamples(const FVector* WorldLocations, int32 Count)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapHeatmapAccumulate);
+	if (Count <= 0 || Counts.Num() == 0)
+	{
+		return;
+	}
+
+	//Each task bins a contiguous chunk into its own histogram, so no two tasks ever write the same cell. The first task owns Counts
+	const int32 NumCells = Counts.Num();
+	const int32 NumTasks = FMath::Clamp(Count / ParallelThreshold, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	while (Partials.Num() < NumTasks - 1)
+	{
+		Partials.AddDefaulted();
+		Partials.Last().SetNumZeroed(NumCells);
+	}
+	PartialCells.SetNumUninitialized(NumTasks, false);
+
+	const FVector2D CellScale(Resolution.X / FMath::Max(TextureSize.X, 1.0f), Resolution.Y / FMath::Max(TextureSize.Y, 1.0f));
+	const int32 ChunkSize = FMath::DivideAndRoundUp(Count, NumTasks);
+	ParallelFor(NumTasks, [this, WorldLocations, Count, ChunkSize, CellScale, NumCells](int32 TaskIndex)
+	{
+		uint32* RESTRICT Partial = TaskIndex == 0 ? Counts.GetData() : Partials[TaskIndex - 1].GetData();
+		const int32 ChunkEnd = FMath::Min((TaskIndex + 1) * ChunkSize, Count);
+		int32 FirstCell = NumCells;
+		int32 LastCell = INDEX_NONE;
+
+		FVector2D TextureLocations[HeatmapProjectBatch];
+		for (int32 Start = TaskIndex * ChunkSize; Start < ChunkEnd; Start += HeatmapProjectBatch)
+		{
+			const int32 BatchCount = FMath::Min(HeatmapProjectBatch, ChunkEnd - Start);
+			Projection.ProjectBatch(WorldLocations + Start, BatchCount, TextureLocations);
+			for (int32 Index = 0; Index < BatchCount; ++Index)
+			{
+				const FVector2D Cell = TextureLocations[Index] * CellScale;
+				if (Cell.X >= 0.0f && Cell.Y >= 0.0f && Cell.X < Resolution.X && Cell.Y < Resolution.Y)
+				{
+					const int32 CellIndex = (int32)Cell.Y * Resolution.X + (int32)Cell.X;
+					++Partial[CellIndex];
+					FirstCell = FMath::Min(FirstCell, CellIndex);
+					LastCell = FMath::Max(LastCell, CellIndex);
+				}
+			}
+		}
+		PartialCells[TaskIndex] = FIntPoint(FirstCell, LastCell);
+	}, NumTasks == 1);
+
+	//Merge only the rows the other tasks binned into, clearing their partials so they are ready for the next batch
+	int32 FirstRow = Resolution.Y;
+	int32 LastRow = INDEX_NONE;
+	for (int32 TaskIndex = 1; TaskIndex < NumTasks; ++TaskIndex)
+	{
+		if (PartialCells[TaskIndex].Y != INDEX_NONE)
+		{
+			FirstRow = FMath::Min(FirstRow, PartialCells[TaskIndex].X / Resolution.X);
+			LastRow = FMath::Max(LastRow, PartialCells[TaskIndex].Y / Resolution.X);
+		}
+	}
+	if (LastRow >= FirstRow)
+	{
+		ParallelFor(LastRow - FirstRow + 1, [this, NumTasks, FirstRow](int32 RowOffset)
+		{
+			const int32 RowStart = (FirstRow + RowOffset) * Resolution.X;
+			const int32 RowEnd = RowStart + Resolution.X - 1;
+			uint32* RESTRICT Out = Counts.GetData() + RowStart;
+			for (int32 TaskIndex = 1; TaskIndex < NumTasks; ++TaskIndex)
+			{
+				if (PartialCells[TaskIndex].X > RowEnd || PartialCells[TaskIndex].Y < RowStart)
+				{
+					continue;
+				}
+				uint32* RESTRICT Partial = Partials[TaskIndex - 1].GetData() + RowStart;
+				for (int32 X = 0; X < Resolution.X; ++X)
+				{
+					Out[X] += Partial[X];
+					Partial[X] = 0;
+				}
+			}
+		}, LastRow - FirstRow < 16);
+	}
+
+	NumSamples += Count;
+	INC_DWORD_STAT_BY(STAT_MapHeatmapSamples, Count);
+}
+
+void FMapHeatmap::Blur(float BlurRadius)
+{
+	const int32 NumCells = Counts.Num();
+	Density.SetNumUninitialized(NumCells, false);
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		Density[Cell] = (float)Counts[Cell];
+	}
+
+	const int32 KernelRadius = FMath::CeilToInt(BlurRadius);
+	if (KernelRadius <= 0)
+	{
+		return;
+	}
+
+	const float Sigma = FMath::Max(BlurRadius * 0.5f, KINDA_SMALL_NUMBER);
+	TArray<float> Kernel;
+	Kernel.SetNumUninitialized(KernelRadius * 2 + 1);
+	float KernelSum = 0.0f;
+	for (int32 Offset = -KernelRadius; Offset <= KernelRadius; ++Offset)
+	{
+		Kernel[Offset + KernelRadius] = FMath::Exp(-(Offset * Offset) / (2.0f * Sigma * Sigma));
+		KernelSum += Kernel[Offset + KernelRadius];
+	}
+	for (float& Weight : Kernel)
+	{
+		Weight /= KernelSum;
+	}
+
+	//Separable, so two passes of 2R+1 taps instead of one of (2R+1)^2. Cells past the edge count as empty
+	BlurScratch.SetNumUninitialized(NumCells, false);
+	ParallelFor(Resolution.Y, [this, &Kernel, KernelRadius](int32 Y)
+	{
+		const float* RESTRICT In = Density.GetData() + Y * Resolution.X;
+		float* RESTRICT Out = BlurScratch.GetData() + Y * Resolution.X;
+		for (int32 X = 0; X < Resolution.X; ++X)
+		{
+			const int32 First = FMath::Max(X - KernelRadius, 0);
+			const int32 Last = FMath::Min(X + KernelRadius, Resolution.X - 1);
+			float Sum = 0.0f;
+			for (int32 Tap = First; Tap <= Last; ++Tap)
+			{
+				Sum += In[Tap] * Kernel[Tap - X + KernelRadius];
+			}
+			Out[X] = Sum;
+		}
+	});
+
+	ParallelFor(Resolution.Y, [this, &Kernel, KernelRadius](int32 Y)
+	{
+		const int32 First = FMath::Max(Y - KernelRadius, 0);
+		const int32 Last = FMath::Min(Y + KernelRadius, Resolution.Y - 1);
+		float* RESTRICT Out = Density.GetData() + Y * Resolution.X;
+		FMemory::Memzero(Out, Resolution.X * sizeof(float));
+		for (int32 Tap = First; Tap <= Last; ++Tap)
+		{
+			const float Weight = Kernel[Tap - Y + KernelRadius];
+			const float* RESTRICT In = BlurScratch.GetData() + Tap * Resolution.X;
+			for (int32 X = 0; X < Resolution.X; ++X)
+			{
+				Out[X] += In[X] * Weight;
+			}
+		}
+	});
+}
+
+void FMapHeatmap::UpdateTexture(float BlurRadius)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapHeatmapUpdateTexture);
+	if (Counts.Num() == 0)
+	{
+		return;
+	}
+
+	Blur(BlurRadius);
+
+	float MaxDensity = 0.0f;
+	for (float Value : Density)
+	{
+		MaxDensity = FMath::Max(MaxDensity, Value);
+	}
+	const float InvMaxDensity = MaxDensity > 0.0f ? 1.0f / MaxDensity : 0.0f;
+
+	if (!Texture || Texture->GetSizeX() != Resolution.X || Texture->GetSizeY() != Resolution.Y)
+	{
+		Texture = UTexture2D::CreateTransient(Resolution.X, Resolution.Y, PF_B8G8R8A8);
+		Texture->SRGB = false;
+		Texture->Filter = TF_Bilinear;
+		Texture->AddressX = TA_Clamp;
+		Texture->AddressY = TA_Clamp;
+		Texture->UpdateResource();
+	}
+
+	//The render thread frees the copy once uploaded
+	const int32 NumCells = Density.Num();
+	FColor* Pixels = new FColor[NumCells];
+	ParallelFor(Resolution.Y, [this, Pixels, InvMaxDensity](int32 Y)
+	{
+		for (int32 Cell = Y * Resolution.X, RowEnd = Cell + Resolution.X; Cell < RowEnd; ++Cell)
+		{
+			const float Heat = Density[Cell] * InvMaxDensity;
+			FLinearColor Color = FLinearColor::LerpUsingHSV(ColdColor, HotColor, Heat);
+			Color.A = FMath::Lerp(ColdColor.A, HotColor.A, Heat);
+			Pixels[Cell] = Color.ToFColor(false);
+		}
+	});
+
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Resolution.X, Resolution.Y);
+	Texture->UpdateTextureRegions(0, 1, Region, Resolution.X * sizeof(FColor), sizeof(FColor), (uint8*)Pixels,
+		[](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+		{
+			delete[] (FColor*)SrcData;
+			delete Regions;
+		});
+}
+
+void FMapHeatmap::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObject(Texture);
+}
\ No newline at end of file
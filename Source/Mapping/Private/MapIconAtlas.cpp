@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapIconAtlas.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Icon Source Textures"), STAT_MapIconSourceTextures, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Icon Atlas Pages"), STAT_MapIconAtlasPages, STATGROUP_Mapping);
+DECLARE_MEMORY_STAT(TEXT("Icon Source Texture Memory"), STAT_MapIconSourceMemory, STATGROUP_Mapping);
+DECLARE_MEMORY_STAT(TEXT("Icon Atlas Memory"), STAT_MapIconAtlasMemory, STATGROUP_Mapping);
+
+void UMapIconAtlasPage::Init(UMapIconAtlas* InAtlas, int32 InPageIndex)
+{
+	Atlas = InAtlas;
+	PageIndex = InPageIndex;
+	ClearColor = FLinearColor::Transparent;
+	OnCanvasRenderTargetUpdate.AddDynamic(this, &UMapIconAtlasPage::DrawIcons);
+}
+
+void UMapIconAtlasPage::DrawIcons(UCanvas* Canvas, int32 Width, int32 Height)
+{
+	if (Atlas.IsValid())
+	{
+		Atlas->DrawPage(Canvas, PageIndex);
+	}
+}
+
+UMapIconAtlas::UMapIconAtlas(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, PageSize(512)
+	, IconScale(5.0f)
+	, Padding(1)
+{
+}
+
+bool UMapIconAtlas::AddIcon(const FSlateBrush& Source, FSlateBrush& OutAtlasBrush)
+{
+	UTexture* Texture = Cast<UTexture>(Source.GetResourceObject());
+	if (!Texture || Source.DrawAs != ESlateBrushDrawType::Image || Source.Tiling != ESlateBrushTileType::NoTile)
+	{
+		return false;
+	}
+
+	//Packed at the scale the icon is drawn at most, but never above the texels the source actually has
+	const FBox2D SourceUV = Source.GetUVRegion().bIsValid ? Source.GetUVRegion() : FBox2D(FVector2D(0.0f, 0.0f), FVector2D(1.0f, 1.0f));
+	const FVector2D SourceTexels = SourceUV.GetSize() * FVector2D(Texture->GetSurfaceWidth(), Texture->GetSurfaceHeight());
+	const FIntPoint Size(
+		FMath::CeilToInt(FMath::Min(Source.ImageSize.X * IconScale, SourceTexels.X)),
+		FMath::CeilToInt(FMath::Min(Source.ImageSize.Y * IconScale, SourceTexels.Y)));
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return false;
+	}
+
+	//Brushes differing only in tint or margin share the packed texels
+	int32 IconIndex = Icons.IndexOfByPredicate([Texture, &SourceUV, &Size](const FIcon& Icon)
+	{
+		return Icon.Texture == Texture && Icon.SourceUV.Min == SourceUV.Min && Icon.SourceUV.Max == SourceUV.Max && Icon.Rect.Size() == Size;
+	});
+	if (IconIndex == INDEX_NONE)
+	{
+		FIcon Icon;
+		Icon.Texture = Texture;
+		Icon.SourceUV = SourceUV;
+		if (!Allocate(Size, Icon.Page, Icon.Rect))
+		{
+			return false;
+		}
+		IconIndex = Icons.Add(Icon);
+		SourceTextures.AddUnique(Texture);
+		DirtyPages[Icon.Page] = true;
+	}
+
+	const FIcon& Icon = Icons[IconIndex];
+	OutAtlasBrush = Source;
+	OutAtlasBrush.SetResourceObject(Pages[Icon.Page]);
+	OutAtlasBrush.SetUVRegion(FBox2D(FVector2D(Icon.Rect.Min) / PageSize, FVector2D(Icon.Rect.Max) / PageSize));
+	return true;
+}
+
+bool UMapIconAtlas::Allocate(const FIntPoint& Size, int32& OutPage, FIntRect& OutRect)
+{
+	const FIntPoint Padded = Size + FIntPoint(Padding * 2, Padding * 2);
+	if (Padded.X > PageSize || Padded.Y > PageSize)
+	{
+		return false;
+	}
+
+	for (int32 Page = 0; Page <= Pages.Num(); ++Page)
+	{
+		if (Page == Pages.Num())
+		{
+			UMapIconAtlasPage* NewPage = Cast<UMapIconAtlasPage>(UCanvasRenderTarget2D::CreateCanvasRenderTarget2D(GetOuter(), UMapIconAtlasPage::StaticClass(), PageSize, PageSize));
+			if (!NewPage)
+			{
+				return false;
+			}
+			NewPage->Init(this, Pages.Num());
+			Pages.Add(NewPage);
+			Shelves.Add({ 0, 0, 0 });
+			DirtyPages.Add(false);
+		}
+
+		//Stay on the current row if it fits, otherwise open a new row below it. An empty row grows to the first icon
+		FShelf& Shelf = Shelves[Page];
+		if (Shelf.CursorX + Padded.X > PageSize || Padded.Y > Shelf.Height)
+		{
+			if (Shelf.CursorX == 0 && Shelf.Y + Padded.Y <= PageSize)
+			{
+				Shelf.Height = Padded.Y;
+			}
+			else if (Shelf.Y + Shelf.Height + Padded.Y <= PageSize)
+			{
+				Shelf = { Shelf.Y + Shelf.Height, Padded.Y, 0 };
+			}
+			else
+			{
+				continue;
+			}
+		}
+
+		OutPage = Page;
+		OutRect = FIntRect(FIntPoint(Shelf.CursorX + Padding, Shelf.Y + Padding), FIntPoint(Shelf.CursorX + Padding, Shelf.Y + Padding) + Size);
+		Shelf.CursorX += Padded.X;
+		return true;
+	}
+	return false;
+}
+
+void UMapIconAtlas::Flush()
+{
+	for (int32 Page = 0; Page < Pages.Num(); ++Page)
+	{
+		if (DirtyPages[Page])
+		{
+			Pages[Page]->UpdateResource();
+			DirtyPages[Page] = false;
+		}
+	}
+	UpdateStats();
+}
+
+void UMapIconAtlas::DrawPage(UCanvas* Canvas, int32 Page) const
+{
+	for (const FIcon& Icon : Icons)
+	{
+		if (Icon.Page == Page)
+		{
+			//Opaque copies the source alpha as is, icons never overlap so nothing needs blending
+			Canvas->K2_DrawTexture(
+				Icon.Texture,
+				FVector2D(Icon.Rect.Min),
+				FVector2D(Icon.Rect.Size()),
+				Icon.SourceUV.Min,
+				Icon.SourceUV.GetSize(),
+				FLinearColor::White,
+				BLEND_Opaque);
+		}
+	}
+}
+
+SIZE_T UMapIconAtlas::GetPageMemory() const
+{
+	return (SIZE_T)Pages.Num() * PageSize * PageSize * GPixelFormats[PF_B8G8R8A8].BlockBytes;
+}
+
+SIZE_T UMapIconAtlas::GetSourceTextureMemory() const
+{
+	SIZE_T Size = 0;
+	for (UTexture* Texture : SourceTextures)
+	{
+		Size += Texture ? Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips) : 0;
+	}
+	return Size;
+}
+
+int32 UMapIconAtlas::NumSourceTextures() const
+{
+	return SourceTextures.Num();
+}
+
+void UMapIconAtlas::UpdateStats() const
+{
+	//Source textures approximate the draw batches markers took before the atlas, pages the batches they take now
+	SET_DWORD_STAT(STAT_MapIconSourceTextures, NumSourceTextures());
+	SET_DWORD_STAT(STAT_MapIconAtlasPages, NumPages());
+	SET_MEMORY_STAT(STAT_MapIconSourceMemory, GetSourceTextureMemory());
+	SET_MEMORY_STAT(STAT_MapIconAtlasMemory, GetPageMemory());
+}
\ No newline at end of file
@@ -0,0 +1,351 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapMarkerClusters.h"
+
+DECLARE_CYCLE_STAT(TEXT("Marker Cluster Rebuild"), STAT_MapMarkerClusterRebuild, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Marker Clusters"), STAT_MapMarkerClusters, STATGROUP_Mapping);
+
+/*Bands past this would need cells wider than any capture texture*/
+static const int32 MaxClusterBand = 8;
+
+FMapMarkerClusters::FMapMarkerClusters()
+	: ExpandTime(0.25f)
+	, Band(INDEX_NONE)
+	, ChangeRevision(0)
+	, ExpandStartTime(-BIG_NUMBER)
+	, CellCounts(0, 0)
+{
+}
+
+int32 FMapMarkerClusters::ComputeBand(float ScreenSize, float Scale)
+{
+	if (ScreenSize <= 0.0f || Scale <= 0.0f)
+	{
+		return INDEX_NONE;
+	}
+
+	const float CellsPerGridCell = ScreenSize / (Scale * FMapMarkerStore::GridCellSize);
+	if (CellsPerGridCell <= 0.5f)
+	{
+		return INDEX_NONE;
+	}
+	return FMath::Min(FMath::Max(FMath::CeilToInt(FMath::Log2(CellsPerGridCell)), 0), MaxClusterBand);
+}
+
+void FMapMarkerClusters::Reset()
+{
+	Band = INDEX_NONE;
+	ExpandStartTime = -BIG_NUMBER;
+	Clusters.Reset();
+	MarkerCells.Reset();
+	MemberSlots.Reset();
+	MarkerFrom.Reset();
+	CellClusters.Reset();
+	CellCounts = FIntPoint(0, 0);
+}
+
+bool FMapMarkerClusters::Update(const FMapMarkerStore& Markers, const FMapClusterFilter& NewFilter, int32 NewBand, float Time)
+{
+	if (NewBand == INDEX_NONE)
+	{
+		if (Band == INDEX_NONE)
+		{
+			return false;
+		}
+
+		//Markers leave from wherever their cluster was drawn
+		CaptureDrawLocations(Markers, true, Time);
+		ExpandStartTime = Time;
+		Band = INDEX_NONE;
+		Clusters.Reset();
+		MarkerCells.Reset();
+		MemberSlots.Reset();
+		CellClusters.Reset();
+		CellCounts = FIntPoint(0, 0);
+		return true;
+	}
+
+	bool bRebuilt = false;
+	const int32 FirstChange = Markers.FindChangesSince(ChangeRevision);
+	if (NewBand != Band || NewFilter != Filter || FirstChange == INDEX_NONE || !ApplyChanges(Markers, FirstChange, Time))
+	{
+		Rebuild(Markers, NewFilter, NewBand, Time);
+		bRebuilt = true;
+	}
+	ChangeRevision = Markers.GetChangeRevision();
+
+	//Only clusters a change touched take their centroid again
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	for (int32 Cell : DirtyCells)
+	{
+		const int32 ClusterIndex = CellClusters[Cell];
+		if (ClusterIndex != INDEX_NONE && Clusters[ClusterIndex].bCentroidDirty)
+		{
+			FMapMarkerCluster& Cluster = Clusters[ClusterIndex];
+			FVector2D Sum = FVector2D::ZeroVector;
+			for (int32 MarkerIndex : Cluster.Members)
+			{
+				Sum += MapLocations[MarkerIndex];
+			}
+			Cluster.Location = Sum / Cluster.Members.Num();
+			Cluster.bCentroidDirty = false;
+		}
+	}
+	DirtyCells.Reset();
+	INC_DWORD_STAT_BY(STAT_MapMarkerClusters, Clusters.Num());
+	return bRebuilt;
+}
+
+bool FMapMarkerClusters::ApplyChanges(const FMapMarkerStore& Markers, int32 FirstChange, float Time)
+{
+	//Removals are replayed in log order so they see the indices of their time, every other change only names a marker to bin again from where it is now
+	const TArray<FMapMarkerChange>& Changes = Markers.GetChanges();
+	ChangedMarkers.Reset();
+	for (int32 ChangeIndex = FirstChange; ChangeIndex < Changes.Num(); ++ChangeIndex)
+	{
+		const FMapMarkerChange& Change = Changes[ChangeIndex];
+		if (Change.MovedFrom == INDEX_NONE)
+		{
+			while (MarkerCells.Num() <= Change.MarkerIndex)
+			{
+				MarkerCells.Add(INDEX_NONE);
+				MemberSlots.Add(INDEX_NONE);
+			}
+			ChangedMarkers.Add(Change.MarkerIndex);
+			continue;
+		}
+
+		if (Change.MovedFrom != MarkerCells.Num() - 1 || !MarkerCells.IsValidIndex(Change.MarkerIndex))
+		{
+			return false;
+		}
+		RemoveMember(Change.MarkerIndex);
+		if (Change.MovedFrom != Change.MarkerIndex)
+		{
+			const int32 Cell = MarkerCells[Change.MovedFrom];
+			MarkerCells[Change.MarkerIndex] = Cell;
+			MemberSlots[Change.MarkerIndex] = MemberSlots[Change.MovedFrom];
+			if (Cell != INDEX_NONE)
+			{
+				Clusters[CellClusters[Cell]].Members[MemberSlots[Change.MarkerIndex]] = Change.MarkerIndex;
+			}
+			if (MarkerFrom.IsValidIndex(Change.MovedFrom))
+			{
+				MarkerFrom[Change.MarkerIndex] = MarkerFrom[Change.MovedFrom];
+			}
+			ChangedMarkers.Add(Change.MarkerIndex);
+		}
+		MarkerCells.Pop(false);
+		MemberSlots.Pop(false);
+		MarkerFrom.SetNum(FMath::Min(MarkerFrom.Num(), Change.MovedFrom), false);
+	}
+	if (MarkerCells.Num() != Markers.Num())
+	{
+		return false;
+	}
+
+	for (int32 MarkerIndex : ChangedMarkers)
+	{
+		if (MarkerIndex >= Markers.Num())
+		{
+			continue;
+		}
+		const int32 Cell = Filter.Matches(Markers, MarkerIndex) ? GetCell(Markers.GetMapLocations()[MarkerIndex]) : INDEX_NONE;
+		if (Cell != MarkerCells[MarkerIndex])
+		{
+			RemoveMember(MarkerIndex);
+			AddMember(Markers, MarkerIndex, Cell, Time);
+		}
+		else if (Cell != INDEX_NONE)
+		{
+			MarkCentroidDirty(CellClusters[Cell]);
+		}
+	}
+	return true;
+}
+
+void FMapMarkerClusters::CaptureDrawLocations(const FMapMarkerStore& Markers, bool bBandChanged, float Time)
+{
+	//Unclustered markers may still be easing out of a cluster
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	DrawnScratch.SetNumUninitialized(Markers.Num(), false);
+	for (int32 MarkerIndex = 0; MarkerIndex < Markers.Num(); ++MarkerIndex)
+	{
+		DrawnScratch[MarkerIndex] = GetMarkerDrawLocation(MarkerIndex, MapLocations[MarkerIndex], Time);
+	}
+
+	//A rebuild within the band keeps the expansion going, so members keep the start of their old cluster
+	for (const FMapMarkerCluster& Cluster : Clusters)
+	{
+		const FVector2D From = bBandChanged ? GetDrawLocation(Cluster, Time) : Cluster.From;
+		for (int32 MarkerIndex : Cluster.Members)
+		{
+			if (DrawnScratch.IsValidIndex(MarkerIndex))
+			{
+				DrawnScratch[MarkerIndex] = From;
+			}
+		}
+	}
+	Exchange(MarkerFrom, DrawnScratch);
+}
+
+void FMapMarkerClusters::Rebuild(const FMapMarkerStore& Markers, const FMapClusterFilter& NewFilter, int32 NewBand, float Time)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapMarkerClusterRebuild);
+
+	const bool bBandChanged = NewBand != Band;
+	CaptureDrawLocations(Markers, bBandChanged, Time);
+	if (bBandChanged)
+	{
+		ExpandStartTime = Time;
+	}
+	Band = NewBand;
+	Filter = NewFilter;
+
+	//Band cells are whole blocks of grid cells
+	const FIntPoint& GridSize = Markers.GetGridSize();
+	CellCounts = FIntPoint(FMath::Max(FMath::DivideAndRoundUp(GridSize.X, 1 << Band), 1), FMath::Max(FMath::DivideAndRoundUp(GridSize.Y, 1 << Band), 1));
+	CellClusters.Init(INDEX_NONE, CellCounts.X * CellCounts.Y);
+	Clusters.Reset();
+	DirtyCells.Reset();
+	MarkerCells.Init(INDEX_NONE, Markers.Num());
+	MemberSlots.Init(INDEX_NONE, Markers.Num());
+
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	for (int32 MarkerIndex = 0; MarkerIndex < Markers.Num(); ++MarkerIndex)
+	{
+		if (Filter.Matches(Markers, MarkerIndex))
+		{
+			AddMember(Markers, MarkerIndex, GetCell(MapLocations[MarkerIndex]), Time);
+		}
+	}
+}
+
+int32 FMapMarkerClusters::GetCell(const FVector2D& Location) const
+{
+	const float InvCellSize = 1.0f / GetCellSize(Band);
+	const int32 X = FMath::Clamp(FMath::FloorToInt(Location.X * InvCellSize), 0, CellCounts.X - 1);
+	const int32 Y = FMath::Clamp(FMath::FloorToInt(Location.Y * InvCellSize), 0, CellCounts.Y - 1);
+	return Y * CellCounts.X + X;
+}
+
+void FMapMarkerClusters::AddMember(const FMapMarkerStore& Markers, int32 MarkerIndex, int32 Cell, float Time)
+{
+	if (Cell == INDEX_NONE)
+	{
+		return;
+	}
+
+	int32 ClusterIndex = CellClusters[Cell];
+	if (ClusterIndex == INDEX_NONE)
+	{
+		//A cluster made while the expansion plays starts where its first member was drawn
+		ClusterIndex = Clusters.AddDefaulted();
+		FMapMarkerCluster& Cluster = Clusters[ClusterIndex];
+		Cluster.Location = Markers.GetMapLocations()[MarkerIndex];
+		Cluster.From = IsAnimating(Time) && MarkerFrom.IsValidIndex(MarkerIndex) ? MarkerFrom[MarkerIndex] : Cluster.Location;
+		Cluster.Cell = Cell;
+		Cluster.bCentroidDirty = false;
+		CellClusters[Cell] = ClusterIndex;
+	}
+	MarkerCells[MarkerIndex] = Cell;
+	MemberSlots[MarkerIndex] = Clusters[ClusterIndex].Members.Add(MarkerIndex);
+	MarkCentroidDirty(ClusterIndex);
+}
+
+void FMapMarkerClusters::RemoveMember(int32 MarkerIndex)
+{
+	const int32 Cell = MarkerCells[MarkerIndex];
+	if (Cell == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 ClusterIndex = CellClusters[Cell];
+	TArray<int32>& Members = Clusters[ClusterIndex].Members;
+	const int32 Slot = MemberSlots[MarkerIndex];
+	Members.RemoveAtSwap(Slot, 1, false);
+	if (Slot < Members.Num())
+	{
+		MemberSlots[Members[Slot]] = Slot;
+	}
+	MarkerCells[MarkerIndex] = INDEX_NONE;
+	MemberSlots[MarkerIndex] = INDEX_NONE;
+
+	if (Members.Num() > 0)
+	{
+		MarkCentroidDirty(ClusterIndex);
+		return;
+	}
+
+	//The last cluster takes the place of an emptied one
+	CellClusters[Cell] = INDEX_NONE;
+	Clusters.RemoveAtSwap(ClusterIndex, 1, false);
+	if (ClusterIndex < Clusters.Num())
+	{
+		CellClusters[Clusters[ClusterIndex].Cell] = ClusterIndex;
+	}
+}
+
+void FMapMarkerClusters::MarkCentroidDirty(int32 ClusterIndex)
+{
+	FMapMarkerCluster& Cluster = Clusters[ClusterIndex];
+	if (!Cluster.bCentroidDirty)
+	{
+		Cluster.bCentroidDirty = true;
+		DirtyCells.Add(Cluster.Cell);
+	}
+}
+
+void FMapMarkerClusters::QueryRect(const FBox2D& TextureRect, float Time, TArray<int32>& OutClusters) const
+{
+	if (IsAnimating(Time))
+	{
+		for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ++ClusterIndex)
+		{
+			OutClusters.Add(ClusterIndex);
+		}
+		return;
+	}
+
+	//Centroids never leave their cell, and cells are visited in cell order so clusters come out in the order they are drawn
+	if (CellClusters.Num() > 0)
+	{
+		const float InvCellSize = 1.0f / GetCellSize(Band);
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt(TextureRect.Min.X * InvCellSize), 0, CellCounts.X - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt(TextureRect.Min.Y * InvCellSize), 0, CellCounts.Y - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt(TextureRect.Max.X * InvCellSize), 0, CellCounts.X - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt(TextureRect.Max.Y * InvCellSize), 0, CellCounts.Y - 1);
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				if (CellClusters[Y * CellCounts.X + X] != INDEX_NONE)
+				{
+					OutClusters.Add(CellClusters[Y * CellCounts.X + X]);
+				}
+			}
+		}
+	}
+}
+
+float FMapMarkerClusters::GetExpandAlpha(float Time) const
+{
+	return ExpandTime > 0.0f ? FMath::Clamp((Time - ExpandStartTime) / ExpandTime, 0.0f, 1.0f) : 1.0f;
+}
+
+FVector2D FMapMarkerClusters::GetDrawLocation(const FMapMarkerCluster& Cluster, float Time) const
+{
+	return FMath::InterpEaseOut(Cluster.From, Cluster.Location, GetExpandAlpha(Time), 2.0f);
+}
+
+FVector2D FMapMarkerClusters::GetMarkerDrawLocation(int32 MarkerIndex, const FVector2D& Location, float Time) const
+{
+	const float Alpha = GetExpandAlpha(Time);
+	if (Band != INDEX_NONE || Alpha >= 1.0f || !MarkerFrom.IsValidIndex(MarkerIndex))
+	{
+		return Location;
+	}
+	return FMath::InterpEaseOut(MarkerFrom[MarkerIndex], Location, Alpha, 2.0f);
+}
\ No newline at end of file
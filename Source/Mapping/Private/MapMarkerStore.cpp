@@ -0,0 +1,666 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapMarkerStore.h"
+#include "SceneMapComponent.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Marker Store Update"), STAT_MapMarkerStoreUpdate, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Markers"), STAT_MapMarkers, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Markers Sampled"), STAT_MapMarkersSampled, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trails"), STAT_MapTrails, STATGROUP_Mapping);
+DECLARE_MEMORY_STAT(TEXT("Trail Memory"), STAT_MapTrailMemory, STATGROUP_Mapping);
+
+EMapMarkerUpdateTier FMapMarkerUpdateContext::ResolveTier(const USceneMapComponent* Component, const FVector& WorldLocation) const
+{
+	if (Component->UpdateTier != EMapMarkerUpdateTier::Auto)
+	{
+		return Component->UpdateTier;
+	}
+
+	if (Component->Mobility == EComponentMobility::Static)
+	{
+		return EMapMarkerUpdateTier::Static;
+	}
+
+	const float DistanceSquared = (WorldLocation - FocusLocation).SizeSquared2D();
+	EMapMarkerUpdateTier DistanceTier = EMapMarkerUpdateTier::Slow;
+	if (DistanceSquared <= FMath::Square(EveryFrameUpdateDistance))
+	{
+		DistanceTier = EMapMarkerUpdateTier::EveryFrame;
+	}
+	else if (DistanceSquared <= FMath::Square(NormalUpdateDistance))
+	{
+		DistanceTier = EMapMarkerUpdateTier::Normal;
+	}
+
+	const int32 PromotedTier = FMath::Min((int32)DistanceTier + FMath::Max(Component->UpdatePriority, 0), (int32)EMapMarkerUpdateTier::EveryFrame);
+	return (EMapMarkerUpdateTier)PromotedTier;
+}
+
+void FMapMarkerHistory::Sample(float Time, const FVector& Location, float StillTime)
+{
+	if (Count > 0 && Locations[Newest].Equals(Location) && Time - Times[Newest] < StillTime)
+	{
+		return;
+	}
+
+	Newest = (Newest + 1) % Capacity;
+	Locations[Newest] = Location;
+	Times[Newest] = Time;
+	Count = FMath::Min(Count + 1, Capacity);
+}
+
+FVector FMapMarkerHistory::Evaluate(float RenderTime, float MaxExtrapolationTime) const
+{
+	if (Count == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	//Dead reckoning from the two newest samples
+	if (RenderTime >= Times[Newest])
+	{
+		if (Count == 1)
+		{
+			return Locations[Newest];
+		}
+		const int32 Previous = Older(Newest);
+		const float Span = Times[Newest] - Times[Previous];
+		const FVector Velocity = Span > KINDA_SMALL_NUMBER ? (Locations[Newest] - Locations[Previous]) / Span : FVector::ZeroVector;
+		return Locations[Newest] + Velocity * FMath::Min(RenderTime - Times[Newest], MaxExtrapolationTime);
+	}
+
+	//Walk back to the pair of samples around RenderTime
+	int32 Later = Newest;
+	for (int32 Step = 1; Step < Count; ++Step)
+	{
+		const int32 Earlier = Older(Later);
+		if (Times[Earlier] <= RenderTime)
+		{
+			const float Alpha = (RenderTime - Times[Earlier]) / FMath::Max(Times[Later] - Times[Earlier], KINDA_SMALL_NUMBER);
+			return FMath::Lerp(Locations[Earlier], Locations[Later], Alpha);
+		}
+		Later = Earlier;
+	}
+	return Locations[Later];
+}
+
+FMapMarkerStore::FMapMarkerStore()
+	: GridSize(0, 0)
+	, GridRevision(0)
+	, ChangeBase(0)
+	, LastUpdateChangeRevision(0)
+	, StaticRevision(0)
+	, MarkerRevision(0)
+	, FrameCounter(0)
+	, NumSampledLastUpdate(0)
+	, PurgeCursor(0)
+{
+	FMemory::Memzero(CategoryCounts);
+}
+
+int32 FMapMarkerStore::Register(USceneMapComponent* Component, const FMapMarkerUpdateContext& Context, uint32 ViewMask)
+{
+	if (!Component)
+	{
+		return INDEX_NONE;
+	}
+
+	//A new reference may add the marker to a view, which changes what views draw
+	++StaticRevision;
+	++MarkerRevision;
+	const int32* ExistingIndex = Indices.Find(Component);
+	if (ExistingIndex)
+	{
+		++RefCounts[*ExistingIndex];
+		Views[*ExistingIndex] |= ViewMask;
+		LogChange(*ExistingIndex);
+		return *ExistingIndex;
+	}
+
+	const FVector WorldLocation = Component->GetComponentLocation();
+	EMapMarkerFlags MarkerFlags = EMapMarkerFlags::None;
+	if (Component->bVisible && !Component->bHiddenInGame)
+	{
+		MarkerFlags |= EMapMarkerFlags::Visible;
+	}
+	if (Component->ClampToMapEdge())
+	{
+		MarkerFlags |= EMapMarkerFlags::ClampToEdge;
+	}
+	if (Component->bUseIconWidget)
+	{
+		MarkerFlags |= EMapMarkerFlags::Widget;
+	}
+
+	const int32 MarkerIndex = Components.Add(Component);
+	WorldLocations.Add(WorldLocation);
+	MapLocations.Add(FVector2D::ZeroVector);
+	const float Yaw = ((uint32)Component->MapCategories & Context.RotatingCategories) ? Component->GetComponentRotation().Yaw : 0.0f;
+	Yaws.Add(Yaw);
+	RotationSteps.Add(QuantizeYaw(Yaw));
+	Flags.Add(MarkerFlags);
+	BrushIds.Add(FindOrAddBrush(Component->MapIcon));
+	Categories.Add((uint32)Component->MapCategories);
+	Views.Add(ViewMask);
+	Tiers.Add(EMapMarkerUpdateTier::Static);
+	TierSlots.Add(INDEX_NONE);
+	RefCounts.Add(1);
+	HistorySlots.Add(INDEX_NONE);
+	TrailSlots.Add(INDEX_NONE);
+	MarkerCells.Add(INDEX_NONE);
+	GridSlots.Add(INDEX_NONE);
+	Indices.Add(Component, MarkerIndex);
+
+	if (Component->bSmoothMapLocation)
+	{
+		HistorySlots[MarkerIndex] = Histories.AddDefaulted();
+		HistoryMarkers.Add(MarkerIndex);
+		Histories[HistorySlots[MarkerIndex]].Sample(Context.Time, WorldLocation, 0.0f);
+	}
+
+	if (Component->bRecordMapTrail)
+	{
+		TrailSlots[MarkerIndex] = Trails.Emplace(Component->MaxMapTrailPoints, Component->MapTrailSampleDistance, Component->MapTrailColor);
+		TrailMarkers.Add(MarkerIndex);
+		Trails[TrailSlots[MarkerIndex]].Sample(WorldLocation, Context.Projection);
+	}
+	CountCategories(Categories[MarkerIndex], 1);
+
+	ProjectMarker(MarkerIndex, Context.Projection);
+	ResizeGrid(Context.Projection);
+	UpdateGridCell(MarkerIndex);
+	AddToTier(MarkerIndex, Context.ResolveTier(Component, WorldLocation));
+	LogChange(MarkerIndex);
+	return MarkerIndex;
+}
+
+void FMapMarkerStore::Unregister(const TWeakObjectPtr<USceneMapComponent>& Component, uint32 ViewMask)
+{
+	const int32* ExistingIndex = Indices.Find(Component);
+	if (ExistingIndex)
+	{
+		const int32 MarkerIndex = *ExistingIndex;
+		Views[MarkerIndex] &= ~ViewMask;
+		++StaticRevision;
+		++MarkerRevision;
+		if (--RefCounts[MarkerIndex] <= 0)
+		{
+			RemoveAt(MarkerIndex);
+		}
+		else
+		{
+			LogChange(MarkerIndex);
+		}
+	}
+}
+
+int32 FMapMarkerStore::Find(USceneMapComponent* Component) const
+{
+	const int32* MarkerIndex = Indices.Find(Component);
+	return MarkerIndex ? *MarkerIndex : INDEX_NONE;
+}
+
+void FMapMarkerStore::Update(const FMapMarkerUpdateContext& Context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapMarkerStoreUpdate);
+
+	const bool bProjectionChanged = !Context.Projection.Equals(LastProjection);
+	LastProjection = Context.Projection;
+	++FrameCounter;
+
+	//Consumers read the log once a frame, so what they all saw by the previous update can go
+	if (LastUpdateChangeRevision > ChangeBase)
+	{
+		Changes.RemoveAt(0, FMath::Min((int32)(LastUpdateChangeRevision - ChangeBase), Changes.Num()), false);
+		ChangeBase = LastUpdateChangeRevision;
+	}
+	LastUpdateChangeRevision = GetChangeRevision();
+
+	//Static markers are never sampled again, the others contribute the due stride of their tier
+	DueMarkers.Reset();
+	for (int32 TierIndex = (int32)EMapMarkerUpdateTier::Slow; TierIndex < NumTiers; ++TierIndex)
+	{
+		int32 Interval = 1;
+		if (TierIndex == (int32)EMapMarkerUpdateTier::Slow)
+		{
+			Interval = FMath::Max(Context.SlowUpdateInterval, 1);
+		}
+		else if (TierIndex == (int32)EMapMarkerUpdateTier::Normal)
+		{
+			Interval = FMath::Max(Context.NormalUpdateInterval, 1);
+		}
+
+		const TArray<int32>& Tier = TierMarkers[TierIndex];
+		for (int32 Slot = FrameCounter % Interval; Slot < Tier.Num(); Slot += Interval)
+		{
+			DueMarkers.Add(Tier[Slot]);
+		}
+	}
+
+	const int32 NumDue = DueMarkers.Num();
+	DueTiers.SetNumUninitialized(NumDue, false);
+	DueAlive.SetNumUninitialized(NumDue, false);
+
+	//Every due marker writes only its own slots, so the component reads can be spread across threads
+	ParallelFor(NumDue, [this, &Context, bProjectionChanged](int32 DueIndex)
+	{
+		const int32 MarkerIndex = DueMarkers[DueIndex];
+		const USceneMapComponent* Component = Components[MarkerIndex].Get();
+		DueAlive[DueIndex] = Component != nullptr;
+		if (Component)
+		{
+			const FVector SampledLocation = Component->GetComponentLocation();
+			const int32 HistorySlot = HistorySlots[MarkerIndex];
+			if (HistorySlot != INDEX_NONE)
+			{
+				Histories[HistorySlot].Sample(Context.Time, SampledLocation, Context.InterpolationDelay + Context.MaxExtrapolationTime);
+			}
+			else
+			{
+				WorldLocations[MarkerIndex] = SampledLocation;
+			}
+			//Building a rotator from the component's quaternion is not free, so markers that never turn skip it
+			if (Categories[MarkerIndex] & Context.RotatingCategories)
+			{
+				Yaws[MarkerIndex] = Component->GetComponentRotation().Yaw;
+				RotationSteps[MarkerIndex] = QuantizeYaw(Yaws[MarkerIndex]);
+			}
+
+			const bool bVisible = Component->bVisible && !Component->bHiddenInGame;
+			Flags[MarkerIndex] = bVisible ? (Flags[MarkerIndex] | EMapMarkerFlags::Visible) : (Flags[MarkerIndex] & ~EMapMarkerFlags::Visible);
+			DueTiers[DueIndex] = Context.ResolveTier(Component, SampledLocation);
+			if (!bProjectionChanged && HistorySlot == INDEX_NONE)
+			{
+				ProjectMarker(MarkerIndex, Context.Projection);
+			}
+		}
+	}, NumDue < ParallelThreshold);
+
+	//ClampToMapEdge may be implemented in Blueprint so it stays on the game thread, along with anything that reshapes the arrays
+	DeadMarkers.Reset();
+	for (int32 DueIndex = 0; DueIndex < NumDue; ++DueIndex)
+	{
+		const int32 MarkerIndex = DueMarkers[DueIndex];
+		if (DueAlive[DueIndex])
+		{
+			const bool bClamp = Components[MarkerIndex]->ClampToMapEdge();
+			Flags[MarkerIndex] = bClamp ? (Flags[MarkerIndex] | EMapMarkerFlags::ClampToEdge) : (Flags[MarkerIndex] & ~EMapMarkerFlags::ClampToEdge);
+			if (DueTiers[DueIndex] != Tiers[MarkerIndex])
+			{
+				RemoveFromTier(MarkerIndex);
+				AddToTier(MarkerIndex, DueTiers[DueIndex]);
+			}
+			if (TrailSlots[MarkerIndex] != INDEX_NONE)
+			{
+				Trails[TrailSlots[MarkerIndex]].Sample(WorldLocations[MarkerIndex], Context.Projection);
+			}
+			if (!bProjectionChanged)
+			{
+				UpdateGridCell(MarkerIndex);
+			}
+			LogChange(MarkerIndex);
+		}
+		else
+		{
+			DeadMarkers.Add(MarkerIndex);
+		}
+	}
+
+	//Markers that are not due, Static ones above all, are walked a few per update so destroyed components never linger as ghost icons
+	for (int32 Checked = 0; Checked < PurgeChecksPerUpdate && Checked < Num(); ++Checked)
+	{
+		if (++PurgeCursor >= Num())
+		{
+			PurgeCursor = 0;
+		}
+		if (!Components[PurgeCursor].IsValid())
+		{
+			DeadMarkers.AddUnique(PurgeCursor);
+		}
+	}
+
+	//Remove from the back so swapped in markers are never ones still pending removal
+	DeadMarkers.Sort(TGreater<int32>());
+	for (int32 MarkerIndex : DeadMarkers)
+	{
+		RemoveAt(MarkerIndex);
+	}
+
+	//Smoothed markers move at display rate from their history, whether or not they were sampled
+	const float RenderTime = Context.Time - Context.InterpolationDelay;
+	ParallelFor(Histories.Num(), [this, &Context, RenderTime, bProjectionChanged](int32 HistorySlot)
+	{
+		const int32 MarkerIndex = HistoryMarkers[HistorySlot];
+		WorldLocations[MarkerIndex] = Histories[HistorySlot].Evaluate(RenderTime, Context.MaxExtrapolationTime);
+		if (!bProjectionChanged)
+		{
+			ProjectMarker(MarkerIndex, Context.Projection);
+		}
+	}, Histories.Num() < ParallelThreshold);
+
+	//Moving the capture moves every marker on the texture, but only cached world locations are needed for that
+	if (bProjectionChanged)
+	{
+		ProjectAll(Context.Projection);
+		ResizeGrid(Context.Projection);
+		for (int32 MarkerIndex = 0; MarkerIndex < Num(); ++MarkerIndex)
+		{
+			UpdateGridCell(MarkerIndex);
+		}
+	}
+	else
+	{
+		for (int32 MarkerIndex : HistoryMarkers)
+		{
+			UpdateGridCell(MarkerIndex);
+			LogChange(MarkerIndex);
+		}
+	}
+
+	NumSampledLastUpdate = NumDue;
+	SET_DWORD_STAT(STAT_MapMarkers, Num());
+	INC_DWORD_STAT_BY(STAT_MapMarkersSampled, NumDue);
+	SET_DWORD_STAT(STAT_MapTrails, Trails.Num());
+	SET_MEMORY_STAT(STAT_MapTrailMemory, GetTrailAllocatedSize());
+}
+
+int32 FMapMarkerStore::FindChangesSince(uint32 Revision) const
+{
+	return Revision >= ChangeBase && Revision <= GetChangeRevision() ? (int32)(Revision - ChangeBase) : INDEX_NONE;
+}
+
+void FMapMarkerStore::LogChange(int32 MarkerIndex, int32 MovedFrom)
+{
+	//Past a few entries per marker starting over is cheaper for consumers than replaying the log
+	if (Changes.Num() >= 4 * Num() + 256)
+	{
+		ResetChanges();
+		return;
+	}
+	Changes.Add({ MarkerIndex, MovedFrom });
+}
+
+void FMapMarkerStore::ResetChanges()
+{
+	ChangeBase = GetChangeRevision() + 1;
+	Changes.Reset();
+}
+
+void FMapMarkerStore::FilterVisible(uint32 CategoryMask, uint32 ViewMask, TArray<uint8>& OutVisible) const
+{
+	const int32 Count = Num();
+	OutVisible.SetNumUninitialized(Count, false);
+
+	const uint32* RESTRICT CategoryData = Categories.GetData();
+	const uint32* RESTRICT ViewData = Views.GetData();
+	const EMapMarkerFlags* RESTRICT FlagData = Flags.GetData();
+	uint8* RESTRICT VisibleData = OutVisible.GetData();
+	for (int32 MarkerIndex = 0; MarkerIndex < Count; ++MarkerIndex)
+	{
+		VisibleData[MarkerIndex] = (uint8)((CategoryData[MarkerIndex] & CategoryMask) != 0) & (uint8)((ViewData[MarkerIndex] & ViewMask) != 0) & ((uint8)FlagData[MarkerIndex] & (uint8)EMapMarkerFlags::Visible);
+	}
+}
+
+uint8 FMapMarkerStore::QuantizeYaw(float Yaw)
+{
+	return (uint8)(FMath::RoundToInt(FRotator::ClampAxis(Yaw) * (NumRotationSteps / 360.0f)) % NumRotationSteps);
+}
+
+float FMapMarkerStore::GetRotationAngle(uint8 RotationStep)
+{
+	return RotationStep * (2.0f * PI / NumRotationSteps);
+}
+
+const FSlateRenderTransform& FMapMarkerStore::GetRotationTransform(uint8 RotationStep)
+{
+	struct FRotationTable
+	{
+		FSlateRenderTransform Transforms[NumRotationSteps];
+		FRotationTable()
+		{
+			for (int32 Step = 0; Step < NumRotationSteps; ++Step)
+			{
+				Transforms[Step] = FSlateRenderTransform(FQuat2D(GetRotationAngle((uint8)Step)));
+			}
+		}
+	};
+	static const FRotationTable Table;
+	return Table.Transforms[RotationStep];
+}
+
+void FMapMarkerStore::QueryRect(const FBox2D& TextureRect, TArray<int32>& OutMarkers) const
+{
+	if (GridCells.Num() > 0)
+	{
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt(TextureRect.Min.X / GridCellSize), 0, GridSize.X - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt(TextureRect.Min.Y / GridCellSize), 0, GridSize.Y - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt(TextureRect.Max.X / GridCellSize), 0, GridSize.X - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt(TextureRect.Max.Y / GridCellSize), 0, GridSize.Y - 1);
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				OutMarkers.Append(GridCells[Y * GridSize.X + X]);
+			}
+		}
+	}
+	OutMarkers.Append(ClampedMarkers);
+}
+
+void FMapMarkerStore::ResizeGrid(const FMapProjection& Projection)
+{
+	const FVector2D TextureSize = FVector2D(Projection.ViewRect.Width(), Projection.ViewRect.Height()) * Projection.ViewToTextureScale;
+	const FIntPoint NewGridSize(FMath::Max(FMath::CeilToInt(TextureSize.X / GridCellSize), 1), FMath::Max(FMath::CeilToInt(TextureSize.Y / GridCellSize), 1));
+	if (NewGridSize == GridSize)
+	{
+		return;
+	}
+
+	//Only a new render target size changes the grid, so rebinning everything here is rare
+	GridSize = NewGridSize;
+	++GridRevision;
+	ResetChanges();
+	GridCells.Reset();
+	GridCells.SetNum(GridSize.X * GridSize.Y);
+	ClampedMarkers.Reset();
+	for (int32 MarkerIndex = 0; MarkerIndex < Num(); ++MarkerIndex)
+	{
+		MarkerCells[MarkerIndex] = INDEX_NONE;
+		UpdateGridCell(MarkerIndex);
+	}
+}
+
+void FMapMarkerStore::UpdateGridCell(int32 MarkerIndex)
+{
+	int32 Cell = ClampedCell;
+	if (!HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge))
+	{
+		const FVector2D& MapLocation = MapLocations[MarkerIndex];
+		const int32 X = FMath::Clamp(FMath::FloorToInt(MapLocation.X / GridCellSize), 0, GridSize.X - 1);
+		const int32 Y = FMath::Clamp(FMath::FloorToInt(MapLocation.Y / GridCellSize), 0, GridSize.Y - 1);
+		Cell = Y * GridSize.X + X;
+	}
+
+	if (Cell != MarkerCells[MarkerIndex])
+	{
+		RemoveFromGrid(MarkerIndex);
+		MarkerCells[MarkerIndex] = Cell;
+		GridSlots[MarkerIndex] = GetGridBucket(Cell).Add(MarkerIndex);
+		++GridRevision;
+	}
+}
+
+void FMapMarkerStore::RemoveFromGrid(int32 MarkerIndex)
+{
+	const int32 Cell = MarkerCells[MarkerIndex];
+	if (Cell != INDEX_NONE)
+	{
+		const int32 Slot = GridSlots[MarkerIndex];
+		TArray<int32>& Bucket = GetGridBucket(Cell);
+		Bucket.RemoveAtSwap(Slot, 1, false);
+		if (Slot < Bucket.Num())
+		{
+			GridSlots[Bucket[Slot]] = Slot;
+		}
+		MarkerCells[MarkerIndex] = INDEX_NONE;
+		GridSlots[MarkerIndex] = INDEX_NONE;
+	}
+}
+
+void FMapMarkerStore::CountCategories(uint32 CategoryMask, int32 Delta)
+{
+	while (CategoryMask)
+	{
+		const uint32 Bit = FMath::CountTrailingZeros(CategoryMask);
+		CategoryCounts[Bit] += Delta;
+		CategoryMask &= CategoryMask - 1;
+	}
+}
+
+void FMapMarkerStore::ProjectAll(const FMapProjection& Projection)
+{
+	++StaticRevision;
+	ResetChanges();
+	//Markers are projected in fixed chunks so each task runs the batched projection over contiguous memory
+	const int32 ChunkSize = 256;
+	const int32 NumChunks = FMath::DivideAndRoundUp(Num(), ChunkSize);
+	ParallelFor(NumChunks, [this, &Projection, ChunkSize](int32 Chunk)
+	{
+		const int32 First = Chunk * ChunkSize;
+		Projection.ProjectBatch(WorldLocations.GetData() + First, FMath::Min(ChunkSize, Num() - First), MapLocations.GetData() + First);
+	}, Num() < ParallelThreshold);
+
+	ParallelFor(Trails.Num(), [this, &Projection](int32 TrailSlot)
+	{
+		Trails[TrailSlot].Project(Projection);
+	}, Trails.Num() < 2);
+}
+
+SIZE_T FMapMarkerStore::GetTrailAllocatedSize() const
+{
+	SIZE_T Size = Trails.GetAllocatedSize();
+	for (const FMapTrail& Trail : Trails)
+	{
+		Size += Trail.GetAllocatedSize();
+	}
+	return Size;
+}
+
+int32 FMapMarkerStore::FindOrAddBrush(const FSlateBrush& Brush)
+{
+	const int32 ExistingId = Brushes.IndexOfByKey(Brush);
+	if (ExistingId != INDEX_NONE)
+	{
+		return ExistingId;
+	}
+	DrawBrushes.Add(Brush);
+	return Brushes.Add(Brush);
+}
+
+void FMapMarkerStore::ProjectMarker(int32 MarkerIndex, const FMapProjection& Projection)
+{
+	FVector TextureLocation;
+	MapLocations[MarkerIndex] = Projection.Project(WorldLocations[MarkerIndex], TextureLocation) ? FVector2D(TextureLocation) : FVector2D::ZeroVector;
+}
+
+void FMapMarkerStore::AddToTier(int32 MarkerIndex, EMapMarkerUpdateTier Tier)
+{
+	Tiers[MarkerIndex] = Tier;
+	TierSlots[MarkerIndex] = TierMarkers[(int32)Tier].Add(MarkerIndex);
+	StaticRevision += Tier == EMapMarkerUpdateTier::Static;
+}
+
+void FMapMarkerStore::RemoveFromTier(int32 MarkerIndex)
+{
+	const int32 Slot = TierSlots[MarkerIndex];
+	TArray<int32>& Tier = TierMarkers[(int32)Tiers[MarkerIndex]];
+	Tier.RemoveAtSwap(Slot, 1, false);
+	if (Slot < Tier.Num())
+	{
+		TierSlots[Tier[Slot]] = Slot;
+	}
+	TierSlots[MarkerIndex] = INDEX_NONE;
+	StaticRevision += Tiers[MarkerIndex] == EMapMarkerUpdateTier::Static;
+}
+
+void FMapMarkerStore::RemoveAt(int32 MarkerIndex)
+{
+	RemoveFromTier(MarkerIndex);
+	RemoveFromGrid(MarkerIndex);
+	++GridRevision;
+	++MarkerRevision;
+	RemoveHistory(MarkerIndex);
+	RemoveTrail(MarkerIndex);
+	CountCategories(Categories[MarkerIndex], -1);
+	Indices.Remove(Components[MarkerIndex]);
+	LogChange(MarkerIndex, Num() - 1);
+
+	Components.RemoveAtSwap(MarkerIndex, 1, false);
+	WorldLocations.RemoveAtSwap(MarkerIndex, 1, false);
+	MapLocations.RemoveAtSwap(MarkerIndex, 1, false);
+	Yaws.RemoveAtSwap(MarkerIndex, 1, false);
+	RotationSteps.RemoveAtSwap(MarkerIndex, 1, false);
+	Flags.RemoveAtSwap(MarkerIndex, 1, false);
+	BrushIds.RemoveAtSwap(MarkerIndex, 1, false);
+	Categories.RemoveAtSwap(MarkerIndex, 1, false);
+	Views.RemoveAtSwap(MarkerIndex, 1, false);
+	Tiers.RemoveAtSwap(MarkerIndex, 1, false);
+	TierSlots.RemoveAtSwap(MarkerIndex, 1, false);
+	RefCounts.RemoveAtSwap(MarkerIndex, 1, false);
+	HistorySlots.RemoveAtSwap(MarkerIndex, 1, false);
+	TrailSlots.RemoveAtSwap(MarkerIndex, 1, false);
+	MarkerCells.RemoveAtSwap(MarkerIndex, 1, false);
+	GridSlots.RemoveAtSwap(MarkerIndex, 1, false);
+
+	//The last marker now lives at MarkerIndex
+	if (MarkerIndex < Num())
+	{
+		Indices.Add(Components[MarkerIndex], MarkerIndex);
+		TierMarkers[(int32)Tiers[MarkerIndex]][TierSlots[MarkerIndex]] = MarkerIndex;
+		if (MarkerCells[MarkerIndex] != INDEX_NONE)
+		{
+			GetGridBucket(MarkerCells[MarkerIndex])[GridSlots[MarkerIndex]] = MarkerIndex;
+		}
+		if (HistorySlots[MarkerIndex] != INDEX_NONE)
+		{
+			HistoryMarkers[HistorySlots[MarkerIndex]] = MarkerIndex;
+		}
+		if (TrailSlots[MarkerIndex] != INDEX_NONE)
+		{
+			TrailMarkers[TrailSlots[MarkerIndex]] = MarkerIndex;
+		}
+	}
+}
+
+void FMapMarkerStore::RemoveHistory(int32 MarkerIndex)
+{
+	const int32 HistorySlot = HistorySlots[MarkerIndex];
+	if (HistorySlot != INDEX_NONE)
+	{
+		Histories.RemoveAtSwap(HistorySlot, 1, false);
+		HistoryMarkers.RemoveAtSwap(HistorySlot, 1, false);
+		if (HistorySlot < Histories.Num())
+		{
+			HistorySlots[HistoryMarkers[HistorySlot]] = HistorySlot;
+		}
+		HistorySlots[MarkerIndex] = INDEX_NONE;
+	}
+}
+
+
+void FMapMarkerStore::RemoveTrail(int32 MarkerIndex)
+{
+	const int32 TrailSlot = TrailSlots[MarkerIndex];
+	if (TrailSlot != INDEX_NONE)
+	{
+		Trails.RemoveAtSwap(TrailSlot, 1, false);
+		TrailMarkers.RemoveAtSwap(TrailSlot, 1, false);
+		if (TrailSlot < Trails.Num())
+		{
+			TrailSlots[TrailMarkers[TrailSlot]] = TrailSlot;
+		}
+		TrailSlots[MarkerIndex] = INDEX_NONE;
+	}
+}
\ No newline at end of file
@@ -6,9 +6,18 @@
 #include "SceneCaptureComponentMap.h"
 #include "UnrealNetwork.h"
 
+/* Largest exploration grid side, keeps the mask texture within common texture limits*/
+static const int32 MaxExplorationCells = 4096;
+
 AMapSourceVolume::AMapSourceVolume()
 	: bAutoIgnoreActorsWithSceneMapComponents(true)
 	, bAutoIgnoreNonStaticActors(true)
+	, bEnableExploration(false)
+	, ExplorationCellSize(100.0f)
+	, ExplorationRevealRadius(1500.0f)
+	, ExplorationFogColor(0.0f, 0.0f, 0.0f, 0.85f)
+	, ExplorationTexture(nullptr)
+	, TrackedActorCell(INDEX_NONE, INDEX_NONE)
 {
 	MeshComp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("EditorCameraMesh"));
 	MeshComp->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
@@ -153,6 +162,176 @@ void AMapSourceVolume::BeginPlay()
 			}
 		}
 	}
+	if (bEnableExploration)
+	{
+		InitExploration();
+	}
+}
+
+void AMapSourceVolume::InitExploration()
+{
+	ExplorationBounds = GetBrushComponent()->CalcBounds(FTransform::Identity).GetBox();
+	const FVector Scale = GetActorScale3D().GetAbs();
+	const FVector Size = ExplorationBounds.GetSize() * Scale;
+	const int32 Width = FMath::Clamp(FMath::CeilToInt(Size.X / ExplorationCellSize), 1, MaxExplorationCells);
+	const int32 Height = FMath::Clamp(FMath::CeilToInt(Size.Y / ExplorationCellSize), 1, MaxExplorationCells);
+	//Grow the cells of volumes that would need more than MaxExplorationCells
+	ExplorationCellSize = FMath::Max(ExplorationCellSize, FMath::Max(Size.X / Width, Size.Y / Height));
+
+	ExplorationGrid.Init(Width, Height);
+	RevealerCells.Init(FIntPoint(INDEX_NONE, INDEX_NONE), ExplorationRevealers.Num());
+	TrackedActorCell = FIntPoint(INDEX_NONE, INDEX_NONE);
+
+	//Slate reads the mask from the alpha channel and multiplies by the brush tint. A8 samples as black, which is enough for a black fog
+	//at a quarter of the memory and upload, other fog colors need white BGRA texels to tint
+	const bool bAlphaOnly = ExplorationFogColor.R == 0.0f && ExplorationFogColor.G == 0.0f && ExplorationFogColor.B == 0.0f;
+	ExplorationTexture = UTexture2D::CreateTransient(Width, Height, bAlphaOnly ? PF_A8 : PF_B8G8R8A8);
+	ExplorationTexture->SRGB = false;
+	ExplorationTexture->Filter = TF_Bilinear;
+	ExplorationTexture->AddressX = TA_Clamp;
+	ExplorationTexture->AddressY = TA_Clamp;
+	ExplorationTexture->UpdateResource();
+	FlushExplorationTexture();
+}
+
+FIntPoint AMapSourceVolume::WorldToExplorationCell(const FVector& WorldLocation) const
+{
+	const FVector Local = (GetActorTransform().InverseTransformPosition(WorldLocation) - ExplorationBounds.Min) * GetActorScale3D().GetAbs();
+	return FIntPoint(FMath::FloorToInt(Local.X / ExplorationCellSize), FMath::FloorToInt(Local.Y / ExplorationCellSize));
+}
+
+void AMapSourceVolume::GetExplorationQuad(FVector& OutOrigin, FVector& OutAxisX, FVector& OutAxisY) const
+{
+	const FTransform& Transform = GetActorTransform();
+	const FVector Scale = GetActorScale3D().GetAbs();
+	const FVector LocalOrigin(ExplorationBounds.Min.X, ExplorationBounds.Min.Y, ExplorationBounds.GetCenter().Z);
+	OutOrigin = Transform.TransformPosition(LocalOrigin);
+	OutAxisX = Transform.TransformVector(FVector(ExplorationGrid.GetWidth() * ExplorationCellSize / FMath::Max(Scale.X, KINDA_SMALL_NUMBER), 0.0f, 0.0f));
+	OutAxisY = Transform.TransformVector(FVector(0.0f, ExplorationGrid.GetHeight() * ExplorationCellSize / FMath::Max(Scale.Y, KINDA_SMALL_NUMBER), 0.0f));
+}
+
+void AMapSourceVolume::AddExplorationRevealer(AActor* Revealer)
+{
+	if (Revealer && !ExplorationRevealers.Contains(Revealer))
+	{
+		ExplorationRevealers.Add(Revealer);
+		RevealerCells.Add(FIntPoint(INDEX_NONE, INDEX_NONE));
+	}
+}
+
+void AMapSourceVolume::RemoveExplorationRevealer(AActor* Revealer)
+{
+	const int32 Index = ExplorationRevealers.IndexOfByKey(Revealer);
+	if (Index != INDEX_NONE)
+	{
+		ExplorationRevealers.RemoveAtSwap(Index);
+		RevealerCells.RemoveAtSwap(Index);
+	}
+}
+
+void AMapSourceVolume::RevealExplorationAt(const FVector& WorldLocation)
+{
+	ExplorationGrid.Reveal(WorldToExplorationCell(WorldLocation), FMath::CeilToInt(ExplorationRevealRadius / ExplorationCellSize));
+}
+
+void AMapSourceVolume::UpdateExploration()
+{
+	const int32 RadiusCells = FMath::CeilToInt(ExplorationRevealRadius / ExplorationCellSize);
+	for (int32 Index = ExplorationRevealers.Num() - 1; Index >= 0; --Index)
+	{
+		AActor* Revealer = ExplorationRevealers[Index].Get();
+		if (!Revealer)
+		{
+			ExplorationRevealers.RemoveAtSwap(Index);
+			RevealerCells.RemoveAtSwap(Index);
+			continue;
+		}
+
+		//Standing inside the same cell can not reveal anything new
+		const FIntPoint Cell = WorldToExplorationCell(Revealer->GetActorLocation());
+		if (Cell != RevealerCells[Index])
+		{
+			RevealerCells[Index] = Cell;
+			ExplorationGrid.Reveal(Cell, RadiusCells);
+		}
+	}
+
+	if (TrackedActor)
+	{
+		const FIntPoint Cell = WorldToExplorationCell(TrackedActor->GetActorLocation());
+		if (Cell != TrackedActorCell)
+		{
+			TrackedActorCell = Cell;
+			ExplorationGrid.Reveal(Cell, RadiusCells);
+		}
+	}
+	FlushExplorationTexture();
+}
+
+void AMapSourceVolume::FlushExplorationTexture()
+{
+	if (!ExplorationTexture || !ExplorationGrid.IsDirty())
+	{
+		return;
+	}
+
+	//Each changed rectangle is one region, stacked in one copy sharing the widest pitch. The render thread frees it when done
+	const TArray<FIntRect>& Rects = ExplorationGrid.GetDirtyRects();
+	const bool bAlphaOnly = ExplorationTexture->GetPixelFormat() == PF_A8;
+	const int32 BytesPerPixel = bAlphaOnly ? 1 : 4;
+	int32 MaxWidth = 0;
+	int32 TotalHeight = 0;
+	for (const FIntRect& Rect : Rects)
+	{
+		MaxWidth = FMath::Max(MaxWidth, Rect.Width());
+		TotalHeight += Rect.Height();
+	}
+	const int32 Pitch = MaxWidth * BytesPerPixel;
+	uint8* Data = new uint8[Pitch * TotalHeight];
+	if (!bAlphaOnly)
+	{
+		FMemory::Memset(Data, 255, Pitch * TotalHeight);
+	}
+
+	FUpdateTextureRegion2D* Regions = new FUpdateTextureRegion2D[Rects.Num()];
+	int32 SrcY = 0;
+	for (int32 Index = 0; Index < Rects.Num(); ++Index)
+	{
+		const FIntRect& Rect = Rects[Index];
+		Regions[Index] = FUpdateTextureRegion2D(Rect.Min.X, Rect.Min.Y, 0, SrcY, Rect.Width(), Rect.Height());
+		ExplorationGrid.ExpandRect(Rect, Data + SrcY * Pitch + (bAlphaOnly ? 0 : 3), BytesPerPixel, Pitch);
+		SrcY += Rect.Height();
+	}
+	ExplorationTexture->UpdateTextureRegions(0, Rects.Num(), Regions, Pitch, BytesPerPixel, Data,
+		[](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+		{
+			delete[] SrcData;
+			delete[] Regions;
+		});
+	ExplorationGrid.ClearDirty();
+}
+
+void AMapSourceVolume::SaveExploration(TArray<uint8>& OutData)
+{
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+	Writer << ExplorationGrid;
+}
+
+bool AMapSourceVolume::LoadExploration(const TArray<uint8>& Data)
+{
+	FMapExplorationGrid Loaded;
+	FMemoryReader Reader(Data);
+	Reader << Loaded;
+
+	//A grid saved before the volume was resized no longer lines up with it
+	if (Reader.IsError() || Loaded.GetWidth() != ExplorationGrid.GetWidth() || Loaded.GetHeight() != ExplorationGrid.GetHeight())
+	{
+		return false;
+	}
+	ExplorationGrid = Loaded;
+	FlushExplorationTexture();
+	return true;
 }
 
 /* Copy past of SceneCaptureComponent.cpp definitions for ASceneCapture2D*/
@@ -206,6 +385,10 @@ void AMapSourceVolume::Tick(float DeltaTime)
 	{
 		MapCaptureComponent->GoToWorldPosition(TrackedActor->GetActorLocation());
 	}
+	if (ExplorationTexture)
+	{
+		UpdateExploration();
+	}
 }
 
 void AMapSourceVolume::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -218,6 +401,7 @@ void AMapSourceVolume::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 void AMapSourceVolume::SetTrackedActor(AActor* Actor)
 {
 	TrackedActor = Actor;
+	MapCaptureComponent->SetMarkerFocusActor(TrackedActor);
 	if (!TrackedActor)
 	{
 		MapCaptureComponent->GoToWorldPosition(MeshComp->GetComponentLocation());
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "MapTrail.h"
+
+FMapTrail::FMapTrail(int32 InCapacity, float InSampleDistance, const FLinearColor& InColor)
+	: Capacity(FMath::Clamp(InCapacity, 2, MaxCapacity))
+	, Head(0)
+	, Count(0)
+	, SampleDistanceSquared(FMath::Square(InSampleDistance))
+	, Color(InColor)
+{
+	Points.SetNumZeroed(Capacity);
+	MapPoints.SetNumZeroed(Capacity);
+}
+
+bool FMapTrail::Sample(const FVector& Location, const FMapProjection& Projection)
+{
+	if (Count > 0 && FVector::DistSquared(Points[Newest()], Location) < SampleDistanceSquared)
+	{
+		return false;
+	}
+
+	//A full ring overwrites its oldest point
+	Points[Head] = Location;
+	Projection.ProjectBatch(&Location, 1, &MapPoints[Head]);
+	Head = (Head + 1) % Capacity;
+	Count = FMath::Min(Count + 1, Capacity);
+	return true;
+}
+
+void FMapTrail::Project(const FMapProjection& Projection)
+{
+	//Points run from the oldest to the end of the buffer, then wrap to the start
+	const int32 First = Oldest();
+	const int32 FirstRun = FMath::Min(Count, Capacity - First);
+	Projection.ProjectBatch(Points.GetData() + First, FirstRun, MapPoints.GetData() + First);
+	Projection.ProjectBatch(Points.GetData(), Count - FirstRun, MapPoints.GetData());
+}
+
+void FMapTrail::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
+
+SIZE_T FMapTrail::GetAllocatedSize() const
+{
+	return Points.GetAllocatedSize() + MapPoints.GetAllocatedSize();
+}
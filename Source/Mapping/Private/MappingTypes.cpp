@@ -1,4 +1,51 @@
 //copyright
 
 #include "MappingPrivatePCH.h"
-#include "MappingTypes.h"
\ No newline at end of file
+#include "MappingTypes.h"
+
+bool FMapProjection::Project(const FVector& WorldLocation, FVector& OutTextureLocation) const
+{
+	FVector2D Result;
+	if (FSceneView::ProjectWorldToScreen(WorldLocation,
+		ViewRect,
+		ViewProjectionMatrix,
+		Result))
+	{
+		OutTextureLocation = FVector(Result.X * ViewToTextureScale.X, Result.Y * ViewToTextureScale.Y, WorldLocation.Z);
+		return true;
+	}
+	return false;
+}
+
+void FMapProjection::ProjectBatch(const FVector* WorldLocations, int32 Count, FVector2D* OutTextureLocations) const
+{
+	//Same math as FSceneView::ProjectWorldToScreen followed by the texture scale
+	const FVector2D HalfSize(0.5f * ViewRect.Width(), 0.5f * ViewRect.Height());
+	const FVector2D Scale = HalfSize * ViewToTextureScale;
+	const FVector2D Offset = (HalfSize + FVector2D(ViewRect.Min.X, ViewRect.Min.Y)) * ViewToTextureScale;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FPlane Result = ViewProjectionMatrix.TransformFVector4(FVector4(WorldLocations[Index], 1.0f));
+		if (Result.W > 0.0f)
+		{
+			const float RHW = 1.0f / Result.W;
+			OutTextureLocations[Index] = FVector2D(Result.X * RHW * Scale.X + Offset.X, -Result.Y * RHW * Scale.Y + Offset.Y);
+		}
+		else
+		{
+			OutTextureLocations[Index] = FVector2D::ZeroVector;
+		}
+	}
+}
+
+FVector FMapProjection::Deproject(const FVector2D& TextureLocation) const
+{
+	//Inverse of ProjectBatch back to normalized device coordinates, then through the inverse view projection
+	const FVector2D HalfSize(0.5f * ViewRect.Width(), 0.5f * ViewRect.Height());
+	const FVector2D ViewLocation = TextureLocation / ViewToTextureScale - FVector2D(ViewRect.Min.X, ViewRect.Min.Y);
+	const FVector4 ScreenLocation(ViewLocation.X / HalfSize.X - 1.0f, 1.0f - ViewLocation.Y / HalfSize.Y, 1.0f, 1.0f);
+
+	const FPlane Result = ViewProjectionMatrix.InverseFast().TransformFVector4(ScreenLocation);
+	return FVector(Result) / (Result.W != 0.0f ? Result.W : 1.0f);
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "MappingPrivatePCH.h"
 #include "GameFramework/Actor.h"
 #include "SceneCaptureComponentMap.h"
+#include "SceneMapComponent.h"
+#include "MapIconAtlas.h"
 
 USceneCaptureComponentMap::USceneCaptureComponentMap(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -14,6 +16,18 @@ USceneCaptureComponentMap::USceneCaptureComponentMap(const FObjectInitializer& O
 	CaptureSource = ESceneCaptureSource::SCS_SceneColorSceneDepth;
 	MaterialParameterName = TEXT("MapTexture");
 	FOVAngle = 120.0f;
+	PrimaryComponentTick.bCanEverTick = true;
+	EveryFrameUpdateDistance = 2000.0f;
+	NormalUpdateDistance = 10000.0f;
+	NormalUpdateInterval = 4;
+	SlowUpdateInterval = 30;
+	MarkerInterpolationDelay = 0.1f;
+	MaxMarkerExtrapolationTime = 0.25f;
+	RotatingMarkerCategories = (int32)MAX_uint32;
+	UsedMarkerViews = 0;
+	bUseIconAtlas = true;
+	IconAtlasScale = 5.0f;
+	IconAtlas = nullptr;
 }
 
 FVector2D USceneCaptureComponentMap::GetViewToTextureScale() const
@@ -56,26 +70,25 @@ FVector USceneCaptureComponentMap::ProjectSceneComponentLocationToTextureLocatio
 
 FVector USceneCaptureComponentMap::ProjectLocationToTextureLocation(const FVector& WorldLocation) const
 {
-	UTextureRenderTarget2D* Target = TextureTarget;
-	if (Target)
+	FVector Result;
+	if (TextureTarget && GetMapProjection().Project(WorldLocation, Result))
 	{
-		const float OrthoHeight = OrthoWidth / (FOVAngle * (float)PI / 360.0f);
-		const FIntPoint CaptureSize(OrthoWidth, OrthoHeight);
-		const FIntRect ViewRect(0, 0, OrthoWidth, OrthoHeight);
-
-		FVector2D Result;
-		if (FSceneView::ProjectWorldToScreen(WorldLocation,
-			ViewRect,
-			GetViewProjectionMatrix(),
-			Result))
-		{
-			const FVector2D ScaleVector = GetViewToTextureScale();
-			return FVector(Result.X, Result.Y, WorldLocation.Z) * FVector(ScaleVector.X, ScaleVector.Y, 1.0f);
-		}
+		return Result;
 	}
 	return FVector::ZeroVector;
 }
 
+FMapProjection USceneCaptureComponentMap::GetMapProjection() const
+{
+	const float OrthoHeight = OrthoWidth / (FOVAngle * (float)PI / 360.0f);
+
+	FMapProjection Projection;
+	Projection.ViewRect = FIntRect(0, 0, OrthoWidth, OrthoHeight);
+	Projection.ViewProjectionMatrix = GetViewProjectionMatrix();
+	Projection.ViewToTextureScale = GetViewToTextureScale();
+	return Projection;
+}
+
 FMatrix USceneCaptureComponentMap::GetViewProjectionMatrix() const
 {
 	FTransform Transform = GetComponentToWorld();
@@ -189,4 +202,124 @@ void USceneCaptureComponentMap::Activate(bool bReset)
 			RenderToMaterial->SetTextureParameterValue(MaterialParameterName, TextureTarget);
 		}
 	}
+}
+
+void USceneCaptureComponentMap::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	MarkerStore.Update(GetMarkerUpdateContext());
+}
+
+void USceneCaptureComponentMap::SetMarkerFocusActor(AActor* Actor)
+{
+	MarkerFocusActor = Actor;
+}
+
+void USceneCaptureComponentMap::CreateHeatmap(FName Heatmap, int32 CellSize)
+{
+	if (!TextureTarget)
+	{
+		return;
+	}
+
+	TSharedPtr<FMapHeatmap>& Found = Heatmaps.FindOrAdd(Heatmap);
+	if (!Found.IsValid())
+	{
+		Found = MakeShareable(new FMapHeatmap());
+	}
+
+	const FVector2D TextureSize(TextureTarget->SizeX, TextureTarget->SizeY);
+	CellSize = FMath::Max(CellSize, 1);
+	Found->Bind(GetMapProjection(), TextureSize, FIntPoint(FMath::DivideAndRoundUp(TextureTarget->SizeX, CellSize), FMath::DivideAndRoundUp(TextureTarget->SizeY, CellSize)));
+}
+
+void USceneCaptureComponentMap::AddHeatmapSamples(FName Heatmap, const TArray<FVector>& WorldLocations)
+{
+	if (TSharedPtr<FMapHeatmap>* Found = Heatmaps.Find(Heatmap))
+	{
+		(*Found)->AddSamples(WorldLocations);
+	}
+}
+
+void USceneCaptureComponentMap::UpdateHeatmapTexture(FName Heatmap, float BlurRadius)
+{
+	if (TSharedPtr<FMapHeatmap>* Found = Heatmaps.Find(Heatmap))
+	{
+		(*Found)->UpdateTexture(BlurRadius);
+	}
+}
+
+void USceneCaptureComponentMap::RemoveHeatmap(FName Heatmap)
+{
+	Heatmaps.Remove(Heatmap);
+}
+
+TSharedPtr<FMapHeatmap> USceneCaptureComponentMap::FindHeatmap(FName Heatmap) const
+{
+	const TSharedPtr<FMapHeatmap>* Found = Heatmaps.Find(Heatmap);
+	return Found ? *Found : TSharedPtr<FMapHeatmap>();
+}
+
+void USceneCaptureComponentMap::RegisterMarker(USceneMapComponent* Component, uint32 ViewMask)
+{
+	const int32 NumBrushes = MarkerStore.NumBrushes();
+	MarkerStore.Register(Component, GetMarkerUpdateContext(), ViewMask);
+	if (bUseIconAtlas && MarkerStore.NumBrushes() > NumBrushes)
+	{
+		AtlasNewBrushes(NumBrushes);
+	}
+}
+
+void USceneCaptureComponentMap::AtlasNewBrushes(int32 FirstBrushId)
+{
+	if (!IconAtlas)
+	{
+		IconAtlas = NewObject<UMapIconAtlas>(this);
+		IconAtlas->IconScale = IconAtlasScale;
+	}
+
+	//Brushes that can not be packed keep drawing from their own resource
+	for (int32 BrushId = FirstBrushId; BrushId < MarkerStore.NumBrushes(); ++BrushId)
+	{
+		FSlateBrush AtlasBrush;
+		if (IconAtlas->AddIcon(MarkerStore.GetSourceBrush(BrushId), AtlasBrush))
+		{
+			MarkerStore.SetDrawBrush(BrushId, AtlasBrush);
+		}
+	}
+	IconAtlas->Flush();
+}
+
+void USceneCaptureComponentMap::UnregisterMarker(const TWeakObjectPtr<USceneMapComponent>& Component, uint32 ViewMask)
+{
+	MarkerStore.Unregister(Component, ViewMask);
+}
+
+uint32 USceneCaptureComponentMap::AcquireMarkerView()
+{
+	//Lowest clear bit
+	const uint32 ViewMask = ~UsedMarkerViews & (UsedMarkerViews + 1);
+	UsedMarkerViews |= ViewMask;
+	return ViewMask;
+}
+
+void USceneCaptureComponentMap::ReleaseMarkerView(uint32 ViewMask)
+{
+	UsedMarkerViews &= ~ViewMask;
+}
+
+FMapMarkerUpdateContext USceneCaptureComponentMap::GetMarkerUpdateContext() const
+{
+	FMapMarkerUpdateContext Context;
+	Context.Projection = GetMapProjection();
+	Context.FocusLocation = MarkerFocusActor.IsValid() ? MarkerFocusActor->GetActorLocation() : GetComponentLocation();
+	Context.EveryFrameUpdateDistance = EveryFrameUpdateDistance;
+	Context.NormalUpdateDistance = NormalUpdateDistance;
+	Context.NormalUpdateInterval = NormalUpdateInterval;
+	Context.SlowUpdateInterval = SlowUpdateInterval;
+	Context.Time = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	Context.InterpolationDelay = MarkerInterpolationDelay;
+	Context.MaxExtrapolationTime = MaxMarkerExtrapolationTime;
+	Context.RotatingCategories = (uint32)RotatingMarkerCategories;
+	return Context;
 }
\ No newline at end of file
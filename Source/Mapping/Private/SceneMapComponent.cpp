@@ -7,6 +7,16 @@
 
 USceneMapComponent::USceneMapComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, MapLabelPriority(0)
+	, UpdateTier(EMapMarkerUpdateTier::Auto)
+	, UpdatePriority(0)
+	, MapCategories(1)
+	, bUseIconWidget(false)
+	, bSmoothMapLocation(false)
+	, bRecordMapTrail(false)
+	, MaxMapTrailPoints(64)
+	, MapTrailSampleDistance(200.0f)
+	, MapTrailColor(FLinearColor::White)
 {
 	MapIcon = FMapStyle::GetDefault().ComponentBrush;
 }
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "AutomationTest.h"
+#include "Tests/MapTestScene.h"
+#include "Widgets/SMap.h"
+#include "Widgets/SPanZoomPanel.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/* Map benchmarks. They report timings through AddInfo and only fail if the map can not be set up, times are for reading in the
+automation log of a development build, not for comparing across machines*/
+
+/*Milliseconds per frame of laying out and painting Widget, after a few frames for scratch to grow*/
+static double TimeMapFrames(FMapTestPainter& Painter, const TSharedRef<SWidget>& Widget, int32 NumFrames)
+{
+	for (int32 Frame = 0; Frame < 4; ++Frame)
+	{
+		Painter.Prepass(Widget);
+		Painter.Paint(Widget);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Painter.Prepass(Widget);
+		Painter.Paint(Widget);
+	}
+	return (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumFrames;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMapMarkerPaintBenchmark, "Mapping.Benchmark.MarkerPaint", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMapMarkerPaintBenchmark::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddWarning(TEXT("Map paint needs Slate, not run"));
+		return true;
+	}
+
+	//The same markers painted by the marker layer and then as one icon widget each, zoomed to fit so none is culled
+	const int32 MarkerCounts[] = { 1000, 10000, 50000 };
+	for (int32 NumMarkers : MarkerCounts)
+	{
+		FMapTestScene Scene;
+		Scene.AddMarkers(NumMarkers, false);
+
+		TSharedPtr<SPanZoomPanel> Panel;
+		TSharedPtr<SMap> Map;
+		SAssignNew(Panel, SPanZoomPanel)
+			+ SPanZoomPanel::Slot()
+			.Position(FVector2D(0.0f, 0.0f))
+			[
+				SAssignNew(Map, SMap)
+				.CaptureComponent(Scene.Map)
+				.ClusterSize(0.0f)
+				.MaxLabels(0)
+			];
+		Panel->SnapToZoom(0.5f);
+		FMapTestPainter Painter(Panel.ToSharedRef(), FVector2D(1280.0f, 720.0f));
+
+		const bool bIconWidgets[] = { false, true };
+		for (bool bIconWidget : bIconWidgets)
+		{
+			for (USceneMapComponent* Component : Scene.Components)
+			{
+				Component->bUseIconWidget = bIconWidget;
+			}
+			Map->SetAll(Scene.Components);
+			Scene.Map->TickComponent(1.0f / 60.0f, LEVELTICK_All, nullptr);
+
+			const double FrameTime = TimeMapFrames(Painter, Panel.ToSharedRef(), 16);
+			AddInfo(FString::Printf(TEXT("%d markers %s: %.3f ms per frame"), NumMarkers, bIconWidget ? TEXT("as icon widgets") : TEXT("painted by the marker layer"), FrameTime));
+			Map->RemoveAll();
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMapSetAllBenchmark, "Mapping.Benchmark.SetAll", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMapSetAllBenchmark::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddWarning(TEXT("Map widgets need Slate, not run"));
+		return true;
+	}
+
+	//2000 shown markers, every SetAll swaps one of them for a spare, as a volume reports one component entering and one leaving
+	const int32 NumMarkers = 2000;
+	const int32 NumCalls = 64;
+	FMapTestScene Scene;
+	Scene.AddMarkers(NumMarkers + NumCalls, false);
+	for (int32 Index = 0; Index < Scene.Components.Num(); Index += 20)
+	{
+		Scene.Components[Index]->bUseIconWidget = true;
+	}
+
+	TSharedRef<SMap> Map = SNew(SMap).CaptureComponent(Scene.Map);
+	TArray<USceneMapComponent*> Shown(Scene.Components.GetData(), NumMarkers);
+	Map->SetAll(Shown);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Call = 0; Call < NumCalls; ++Call)
+	{
+		Shown[Call] = Scene.Components[NumMarkers + Call];
+		Map->SetAll(Shown);
+	}
+	const double DiffTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumCalls;
+
+	//Against clearing and adding everything again, what SetAll did before it applied only the difference
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Call = 0; Call < NumCalls; ++Call)
+	{
+		Shown[Call] = Scene.Components[Call];
+		Map->RemoveAll();
+		Map->SetAll(Shown);
+	}
+	const double ClearTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumCalls;
+
+	AddInfo(FString::Printf(TEXT("SetAll of %d markers with 1 changed: %.3f ms, after RemoveAll: %.3f ms"), NumMarkers, DiffTime, ClearTime));
+	Map->RemoveAll();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMapPickBenchmark, "Mapping.Benchmark.PickMarkers", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMapPickBenchmark::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddWarning(TEXT("Map widgets need Slate, not run"));
+		return true;
+	}
+
+	//20000 markers, half of them static, picked at cursor positions spread over the window as hovering would
+	const int32 NumMarkers = 20000;
+	const int32 NumQueries = 4096;
+	FMapTestScene Scene;
+	Scene.AddMarkers(NumMarkers, false);
+	for (int32 Index = 0; Index < Scene.Components.Num(); Index += 2)
+	{
+		Scene.Components[Index]->UpdateTier = EMapMarkerUpdateTier::Static;
+	}
+
+	TSharedPtr<SPanZoomPanel> Panel;
+	TSharedPtr<SMap> Map;
+	SAssignNew(Panel, SPanZoomPanel)
+		+ SPanZoomPanel::Slot()
+		.Position(FVector2D(0.0f, 0.0f))
+		[
+			SAssignNew(Map, SMap)
+			.CaptureComponent(Scene.Map)
+			.MaxLabels(0)
+		];
+	Map->SetAll(Scene.Components);
+	Scene.Map->TickComponent(1.0f / 60.0f, LEVELTICK_All, nullptr);
+
+	const FVector2D WindowSize(1280.0f, 720.0f);
+	FMapTestPainter Painter(Panel.ToSharedRef(), WindowSize);
+	TArray<USceneMapComponent*> Picked;
+	Picked.Reserve(NumMarkers);
+
+	//Zoomed in picks single markers, zoomed out picks clusters
+	const float Zooms[] = { 1.0f, 0.05f };
+	for (float Zoom : Zooms)
+	{
+		Panel->SnapToZoom(Zoom);
+		TimeMapFrames(Painter, Panel.ToSharedRef(), 1);
+
+		FRandomStream Random(0);
+		int32 NumPicked = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			Picked.Reset();
+			Map->PickMarkers(FVector2D(Random.FRand() * WindowSize.X, Random.FRand() * WindowSize.Y), Picked);
+			NumPicked += Picked.Num();
+		}
+		const double QueryTime = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NumQueries;
+		AddInfo(FString::Printf(TEXT("PickMarkers over %d markers at zoom %.2f: %.3f us per query, %.2f markers per hit"), NumMarkers, Zoom, QueryTime, (float)NumPicked / NumQueries));
+	}
+
+	Map->RemoveAll();
+	return true;
+}
+
+#endif
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "AutomationTest.h"
+#include "Tests/MapTestScene.h"
+#include "Widgets/SMap.h"
+#include "Widgets/SPanZoomPanel.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/* Allocator installed over GMalloc for the length of a measurement, forwarding everything and counting what the game thread allocates*/
+class FMapCountingMalloc : public FMalloc
+{
+public:
+	explicit FMapCountingMalloc(FMalloc* InInner)
+		: Inner(InInner)
+	{}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		//A realloc may grow in place, but any reallocation is one the paint scratch was meant to avoid
+		if (Count > 0)
+		{
+			CountAllocation();
+		}
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override
+	{
+		Inner->Free(Original);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return Inner->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual void Trim() override
+	{
+		Inner->Trim();
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return Inner->IsInternallyThreadSafe();
+	}
+
+	virtual bool ValidateHeap() override
+	{
+		return Inner->ValidateHeap();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return Inner->GetDescriptiveName();
+	}
+
+	void Install()
+	{
+		NumAllocations.Reset();
+		GMalloc = this;
+	}
+
+	int32 Uninstall()
+	{
+		GMalloc = Inner;
+		return NumAllocations.GetValue();
+	}
+
+private:
+	FORCEINLINE void CountAllocation()
+	{
+		//Render and task threads keep allocating while the game thread paints, only paint is measured
+		if (IsInGameThread())
+		{
+			NumAllocations.Increment();
+		}
+	}
+
+	FMalloc* Inner;
+	FThreadSafeCounter NumAllocations;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMapPaintAllocationTest, "Mapping.Paint.SteadyStateAllocations", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMapPaintAllocationTest::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddWarning(TEXT("Map paint needs Slate for its fonts, not run"));
+		return true;
+	}
+
+	//Every kind of map content: painted markers, icon widgets, trails, labels, and clusters when zoomed out
+	FMapTestScene Scene;
+	Scene.AddMarkers(2000, false);
+	for (int32 Index = 0; Index < Scene.Components.Num(); ++Index)
+	{
+		USceneMapComponent* Component = Scene.Components[Index];
+		Component->MapLabel = FText::FromString(FString::Printf(TEXT("Marker %d"), Index));
+		Component->bUseIconWidget = Index % 200 == 0;
+		Component->bRecordMapTrail = Index % 50 == 0;
+		Component->UpdateTier = Component->bRecordMapTrail ? EMapMarkerUpdateTier::EveryFrame : EMapMarkerUpdateTier::Auto;
+	}
+
+	TSharedPtr<SPanZoomPanel> Panel;
+	TSharedPtr<SMap> Map;
+	SAssignNew(Panel, SPanZoomPanel)
+		+ SPanZoomPanel::Slot()
+		.Position(FVector2D(0.0f, 0.0f))
+		[
+			SAssignNew(Map, SMap)
+			.CaptureComponent(Scene.Map)
+		];
+	Map->SetAll(Scene.Components);
+
+	//Trails need a few points, taken as the markers walk and the store samples them
+	for (int32 Step = 1; Step <= 8; ++Step)
+	{
+		for (USceneMapComponent* Component : Scene.Components)
+		{
+			if (Component->bRecordMapTrail)
+			{
+				Component->AddWorldOffset(FVector(Component->MapTrailSampleDistance * 2.0f, 0.0f, 0.0f));
+			}
+		}
+		Scene.Map->TickComponent(1.0f / 60.0f, LEVELTICK_All, nullptr);
+	}
+
+	FMapTestPainter Painter(Panel.ToSharedRef(), FVector2D(1280.0f, 720.0f));
+	static FMapCountingMalloc CountingMalloc(GMalloc);
+	const float Zooms[] = { 0.05f, 1.0f };
+	for (float Zoom : Zooms)
+	{
+		Panel->SnapToZoom(Zoom);
+
+		//The first frames at a zoom lay out, shape text and grow scratch to its high water mark
+		const int32 WarmUpFrames = 8;
+		for (int32 Frame = 0; Frame < WarmUpFrames; ++Frame)
+		{
+			Painter.Prepass(Panel.ToSharedRef());
+			Painter.Paint(Panel.ToSharedRef());
+		}
+
+		const int32 MeasuredFrames = 16;
+		int32 NumAllocations = 0;
+		for (int32 Frame = 0; Frame < MeasuredFrames; ++Frame)
+		{
+			Painter.Prepass(Panel.ToSharedRef());
+			CountingMalloc.Install();
+			Painter.Paint(Panel.ToSharedRef());
+			NumAllocations += CountingMalloc.Uninstall();
+		}
+
+		TestEqual(FString::Printf(TEXT("Heap allocations over %d steady frames of map paint at zoom %.2f"), MeasuredFrames, Zoom), NumAllocations, 0);
+	}
+
+	Map->RemoveAll();
+	return true;
+}
+
+#endif
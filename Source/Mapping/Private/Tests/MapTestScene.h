@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SceneCaptureComponentMap.h"
+#include "SceneMapComponent.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+Map capture looking straight down on a square of the world with markers scattered over it, for the map automation tests. Nothing is
+registered with a world, the capture never renders and the markers are only read through the marker store. Every object is rooted
+for the lifetime of the scene so a garbage collection during a latent test can not take it away.
+**/
+struct FMapTestScene
+{
+	/*World units per side of the square the markers are scattered over*/
+	static const int32 WorldExtent = 100000;
+
+	USceneCaptureComponentMap* Map;
+	TArray<USceneMapComponent*> Components;
+
+	FMapTestScene(int32 TextureSize = 2048)
+	{
+		UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
+		Target->SizeX = TextureSize;
+		Target->SizeY = TextureSize;
+		Target->AddToRoot();
+
+		Map = NewObject<USceneCaptureComponentMap>(GetTransientPackage());
+		Map->bCaptureEveryFrame = false;
+		Map->ProjectionType = ECameraProjectionMode::Orthographic;
+		Map->OrthoWidth = WorldExtent;
+		Map->TextureTarget = Target;
+		Map->SetWorldLocationAndRotation(FVector(0.0f, 0.0f, WorldExtent), FRotator(-90.0f, 0.0f, 0.0f));
+		Map->AddToRoot();
+	}
+
+	~FMapTestScene()
+	{
+		for (USceneMapComponent* Component : Components)
+		{
+			Component->RemoveFromRoot();
+		}
+		Map->TextureTarget->RemoveFromRoot();
+		Map->RemoveFromRoot();
+	}
+
+	/*Make NumMarkers components at random locations in a repeatable pattern, optionally registering them with the capture*/
+	void AddMarkers(int32 NumMarkers, bool bRegister, int32 Seed = 0)
+	{
+		FRandomStream Random(Seed);
+		Components.Reserve(Components.Num() + NumMarkers);
+		for (int32 Marker = 0; Marker < NumMarkers; ++Marker)
+		{
+			const float HalfExtent = WorldExtent * 0.45f;
+			USceneMapComponent* Component = NewObject<USceneMapComponent>(GetTransientPackage());
+			Component->SetWorldLocation(FVector(Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-HalfExtent, HalfExtent), 0.0f));
+			Component->AddToRoot();
+			Components.Add(Component);
+			if (bRegister)
+			{
+				Map->RegisterMarker(Component);
+			}
+		}
+	}
+};
+
+/* Paints a widget the way its window would, into a draw element list that is reset before every paint as the renderer does*/
+struct FMapTestPainter
+{
+	TSharedRef<SWindow> Window;
+	FSlateWindowElementList ElementList;
+	FHittestGrid HittestGrid;
+	FVector2D Size;
+	double Time;
+
+	FMapTestPainter(const TSharedRef<SWidget>& Content, const FVector2D& InSize)
+		: Window(SNew(SWindow).ClientSize(InSize)[Content])
+		, ElementList(Window)
+		, Size(InSize)
+		, Time(0.0)
+	{}
+
+	/*Start a frame: drop the last frame's elements and lay the widget out*/
+	void Prepass(const TSharedRef<SWidget>& Widget)
+	{
+		ElementList.ResetBuffers();
+		Widget->SlatePrepass(1.0f);
+	}
+
+	/*Paint one frame, widgets tick as they paint*/
+	void Paint(const TSharedRef<SWidget>& Widget, float DeltaTime = 1.0f / 60.0f)
+	{
+		Time += DeltaTime;
+		const FGeometry Geometry = FGeometry::MakeRoot(Size, FSlateLayoutTransform());
+		Widget->Paint(FPaintArgs(Window.Get(), HittestGrid, FVector2D::ZeroVector, Time, DeltaTime), Geometry, FSlateRect(FVector2D::ZeroVector, Size), ElementList, 0, FWidgetStyle(), true);
+	}
+};
+
+#endif
@@ -7,13 +7,24 @@
 
 
 FMapStyle::FMapStyle()
+	: ClusterFont(FPaths::EngineContentDir() / TEXT("Slate/Fonts/Roboto-Bold.ttf"), 12)
+	, LabelFont(FPaths::EngineContentDir() / TEXT("Slate/Fonts/Roboto-Regular.ttf"), 10)
+	, LabelColor(FLinearColor::White)
 {
+	//No mask without the plugin content, an empty image brush would cover the minimap in white
+	MinimapMaskBrush.DrawAs = ESlateBrushDrawType::NoDrawType;
+	//An image brush without a resource draws plain white
+	TrailBrush.ImageSize = FVector2D(2.0f, 2.0f);
+
 	TSharedPtr<IPlugin> MappingPlugin = IPluginManager::Get().FindPlugin("Mapping");
 	if (MappingPlugin.IsValid())
 	{
 		FString PluginContentPath = MappingPlugin->GetContentDir();
 		BackgroundImage = FSlateDynamicImageBrush(FName(*(PluginContentPath / TEXT("DefaultBackground_640x360.png"))), FVector2D(640, 360));
 		ComponentBrush = FSlateDynamicImageBrush(FName(*(PluginContentPath / TEXT("MapIconNuetral_256x256.png"))), FVector2D(64, 64));
+		ClusterBrush = FSlateDynamicImageBrush(FName(*(PluginContentPath / TEXT("MapIconNuetral_256x256.png"))), FVector2D(48, 48));
+		//White outside a circle and clear inside, tinted to the frame color
+		MinimapMaskBrush = FSlateDynamicImageBrush(FName(*(PluginContentPath / TEXT("MinimapMask_256x256.png"))), FVector2D(256, 256), FLinearColor::Black);
 	}
 }
 
@@ -34,4 +45,7 @@ void FMapStyle::GetResources(TArray<const FSlateBrush*>& OutBrushes) const
 {
 	OutBrushes.Add(&BackgroundImage);
 	OutBrushes.Add(&ComponentBrush);
+	OutBrushes.Add(&ClusterBrush);
+	OutBrushes.Add(&TrailBrush);
+	OutBrushes.Add(&MinimapMaskBrush);
 }
\ No newline at end of file
@@ -1,43 +1,146 @@
 #include "MappingPrivatePCH.h"
 #include "Widgets/SMap.h"
+#include "Widgets/SMapMarkerLayer.h"
+#include "Widgets/SMapLabelLayer.h"
+#include "Widgets/SMapIconCanvas.h"
 #include "Widgets/SCanvas.h"
+#include "Widgets/SInvalidationPanel.h"
 #include "SceneMapComponent.h"
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Marker Icon Widgets"), STAT_MapMarkerIconWidgets, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Map Set All"), STAT_MapSetAll, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Map Set All Added"), STAT_MapSetAllAdded, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Map Set All Removed"), STAT_MapSetAllRemoved, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Map Stale Icons Purged"), STAT_MapStaleIconsPurged, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Map Static Content Redraws"), STAT_MapStaticContentRedraws, STATGROUP_Mapping);
+
+/*Icons checked for a destroyed component per tick, so a full sweep is spread over frames*/
+static const int32 StaleIconSweepBudget = 64;
+
 void SMap::Construct(const FArguments& InArgs)
 {
+	StaticSlot = nullptr;
+	MarkerLayerSlot = nullptr;
+	LabelLayerSlot = nullptr;
+	IconCanvasSlot = nullptr;
+	SweepCursor = 0;
+	CachedPosition = FVector2D::ZeroVector;
+	CachedScale = 0.0f;
+	CachedStaticRevision = 0;
+
 	ChildSlot
 		[
 			SAssignNew(Canvas, SCanvas)
 		];
 
+	SAssignNew(MarkerLayer, SMapMarkerLayer)
+		.ActiveCategories(InArgs._ActiveCategories)
+		.MapStyle(InArgs._MapStyle)
+		.ClusterSize(InArgs._ClusterSize)
+		.Content(EMapMarkerLayerContent::Dynamic);
+
+	SAssignNew(StaticLayer, SMapMarkerLayer)
+		.ActiveCategories(InArgs._ActiveCategories)
+		.MapStyle(InArgs._MapStyle)
+		.ClusterSize(InArgs._ClusterSize)
+		.Content(EMapMarkerLayerContent::Static)
+		.ViewSource(MarkerLayer);
+
+	TSharedRef<SOverlay> StaticContent = SNew(SOverlay);
 	if (InArgs._CaptureComponent)
 	{
 		SAssignNew(RenderImage, SImage)
 			.Image(&MapBrush);
+		StaticContent->AddSlot()
+			[
+				RenderImage.ToSharedRef()
+			];
+	}
+	StaticContent->AddSlot()
+		[
+			StaticLayer.ToSharedRef()
+		];
 
-		SetCaptureComponent(InArgs._CaptureComponent);
+	//The map image, overlays and static markers only change with the view, so their draw elements are recorded once and replayed until Tick invalidates them
+	StaticSlot = &Canvas->AddSlot()
+		.HAlign(HAlign_Center)
+		.VAlign(VAlign_Center)
+		[
+			SAssignNew(StaticPanel, SInvalidationPanel)
+			[
+				StaticContent
+			]
+		];
 
-		if (Canvas.IsValid() && RenderImage.IsValid())
-		{
-			MapSlot = &Canvas->AddSlot()
-				.HAlign(HAlign_Center)
-				.VAlign(VAlign_Center)
-				.Position(MapBrush.ImageSize / 2.0f)
-				.Size(MapBrush.ImageSize)
-				[
-					RenderImage.ToSharedRef()
-				];
-		}
-	}
+	//Moving marker content draws over the static content and under icon widgets
+	MarkerLayerSlot = &Canvas->AddSlot()
+		.HAlign(HAlign_Center)
+		.VAlign(VAlign_Center)
+		[
+			MarkerLayer.ToSharedRef()
+		];
+
+	//Labels go over every painted marker but under icon widgets
+	LabelLayerSlot = &Canvas->AddSlot()
+		.HAlign(HAlign_Center)
+		.VAlign(VAlign_Center)
+		[
+			SAssignNew(LabelLayer, SMapLabelLayer)
+			.MapStyle(InArgs._MapStyle)
+			.MaxLabels(InArgs._MaxLabels)
+			.MarkerLayer(MarkerLayer)
+			.ViewZoom(InArgs._ViewZoom)
+		];
+
+	IconCanvasSlot = &Canvas->AddSlot()
+		.HAlign(HAlign_Center)
+		.VAlign(VAlign_Center)
+		[
+			SAssignNew(IconCanvas, SMapIconCanvas)
+		];
+
+	SetCaptureComponent(InArgs._CaptureComponent);
 }
 
 SMap::~SMap()
 {
-
+	for (const FMapIcon& Icon : Icons)
+	{
+		if (Map.IsValid())
+		{
+			Map->UnregisterMarker(Icon.Component, MarkerLayer->GetViewMask());
+		}
+		if (Icon.Widget.IsSet())
+		{
+			DEC_DWORD_STAT(STAT_MapMarkerIconWidgets);
+		}
+	}
+	StaticLayer->SetCaptureComponent(nullptr);
+	MarkerLayer->SetCaptureComponent(nullptr);
+	LabelLayer->SetCaptureComponent(nullptr);
 }
 
 void SMap::SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent)
 {
+	//Marker registrations follow the icons to the new capture, under the view the layer gets there
+	if (Map.IsValid())
+	{
+		for (const FMapIcon& Icon : Icons)
+		{
+			Map->UnregisterMarker(Icon.Component, MarkerLayer->GetViewMask());
+		}
+	}
+	MarkerLayer->SetCaptureComponent(NewMapCaptureComponent);
+	StaticLayer->SetCaptureComponent(NewMapCaptureComponent);
+	LabelLayer->SetCaptureComponent(NewMapCaptureComponent);
+	if (NewMapCaptureComponent)
+	{
+		for (const FMapIcon& Icon : Icons)
+		{
+			NewMapCaptureComponent->RegisterMarker(Icon.Component.Get(), MarkerLayer->GetViewMask());
+		}
+	}
+
 	Map = NewMapCaptureComponent;
 	if (Map.IsValid())
 	{
@@ -55,44 +158,78 @@ void SMap::SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent
 		MapBrush.ImageSize = FVector2D::ZeroVector;
 		MapBrush.DrawAs = ESlateBrushDrawType::NoDrawType;
 	}
-	if (MapSlot != nullptr)
+	if (StaticSlot != nullptr)
+	{
+		StaticSlot->Position(MapBrush.ImageSize / 2.0f);
+		StaticSlot->Size(MapBrush.ImageSize);
+	}
+	if (MarkerLayerSlot != nullptr)
+	{
+		MarkerLayerSlot->Position(MapBrush.ImageSize / 2.0f);
+		MarkerLayerSlot->Size(MapBrush.ImageSize);
+	}
+	if (LabelLayerSlot != nullptr)
 	{
-		MapSlot->Position(MapBrush.ImageSize / 2.0f);
-		MapSlot->Size(MapBrush.ImageSize);
+		LabelLayerSlot->Position(MapBrush.ImageSize / 2.0f);
+		LabelLayerSlot->Size(MapBrush.ImageSize);
 	}
+	if (IconCanvasSlot != nullptr)
+	{
+		IconCanvasSlot->Position(MapBrush.ImageSize / 2.0f);
+		IconCanvasSlot->Size(MapBrush.ImageSize);
+	}
+	InvalidateStaticContent();
 	Invalidate(EInvalidateWidget::LayoutAndVolatility);
 }
 
 void SMap::Add(USceneMapComponent* Component)
 {
 	if (Component &&
-		!MapIcons.Contains(Component) &&
+		!IconIndices.Contains(Component) &&
 		Map.IsValid() &&
-		Canvas.IsValid())
+		IconCanvas.IsValid())
 	{
 		TWeakObjectPtr<USceneMapComponent> ToAdd(Component);
-		TSharedRef<SWidget> Content = OnGenerateChildIcon(Component, Map.Get());
-		MapIcons.Add(ToAdd, Content);
-		Canvas->AddSlot()
-			.HAlign(HAlign_Center)
-			.VAlign(VAlign_Center)
-			.Size(Component->MapIcon.ImageSize)
-			.Position(CreateComponentToMapPositionAttribute(Component))
-			[
-				Content
-			];
+		Map->RegisterMarker(Component, MarkerLayer->GetViewMask());
+
+		FMapIcon Icon;
+		Icon.Component = ToAdd;
+		if (Component->bUseIconWidget)
+		{
+			Icon.Widget = IconCanvas->AddIcon(OnGenerateChildIcon(Component, Map.Get()), CreateComponentToMapPositionAttribute(Component), Component->MapIcon.ImageSize);
+			INC_DWORD_STAT(STAT_MapMarkerIconWidgets);
+		}
+		IconIndices.Add(ToAdd, Icons.Add(Icon));
 	}
 }
 
 void SMap::Remove(USceneMapComponent* Component)
 {
-	if (Component &&
-		MapIcons.Contains(Component) &&
-		Canvas.IsValid())
+	const int32* IconIndex = Component ? IconIndices.Find(Component) : nullptr;
+	if (IconIndex)
+	{
+		RemoveIconAt(*IconIndex);
+	}
+}
+
+void SMap::RemoveIconAt(int32 IconIndex)
+{
+	const FMapIcon& Icon = Icons[IconIndex];
+	if (IconCanvas->RemoveIcon(Icon.Widget))
+	{
+		DEC_DWORD_STAT(STAT_MapMarkerIconWidgets);
+	}
+	if (Map.IsValid())
+	{
+		Map->UnregisterMarker(Icon.Component, MarkerLayer->GetViewMask());
+	}
+	IconIndices.Remove(Icon.Component);
+
+	//The last icon moves into the hole
+	Icons.RemoveAtSwap(IconIndex, 1, false);
+	if (IconIndex < Icons.Num())
 	{
-		TSharedRef<SWidget> ToRemove = MapIcons[Component];
-		Canvas->RemoveSlot(ToRemove);
-		MapIcons.Remove(Component);
+		IconIndices.Add(Icons[IconIndex].Component, IconIndex);
 	}
 }
 
@@ -103,27 +240,188 @@ void SMap::RemoveAll()
 
 void SMap::SetAll(const TArray<USceneMapComponent*>& NewSceneComponents)
 {
-	RemoveAllWithSlack(NewSceneComponents.Num());
-	for (auto NewComponent : NewSceneComponents)
+	SCOPE_CYCLE_COUNTER(STAT_MapSetAll);
+	if (!IconCanvas.IsValid())
+	{
+		return;
+	}
+
+	//Apply only the difference, so icons that stay keep their widgets and canvas slots
+	TSet<USceneMapComponent*> Wanted;
+	Wanted.Reserve(NewSceneComponents.Num());
+	for (USceneMapComponent* Component : NewSceneComponents)
+	{
+		Wanted.Add(Component);
+	}
+
+	//Walking down means the icon swapped into a hole was already checked. Destroyed components have null keys, which are never wanted
+	int32 NumRemoved = 0;
+	for (int32 IconIndex = Icons.Num() - 1; IconIndex >= 0; --IconIndex)
+	{
+		if (!Wanted.Contains(Icons[IconIndex].Component.Get()))
+		{
+			RemoveIconAt(IconIndex);
+			++NumRemoved;
+		}
+	}
+
+	const int32 NumBefore = Icons.Num();
+	for (USceneMapComponent* NewComponent : NewSceneComponents)
 	{
 		Add(NewComponent);
 	}
+	INC_DWORD_STAT_BY(STAT_MapSetAllRemoved, NumRemoved);
+	INC_DWORD_STAT_BY(STAT_MapSetAllAdded, Icons.Num() - NumBefore);
 }
 
 void SMap::RemoveAllWithSlack(int32 Slack)
 {
-	TArray<TWeakObjectPtr<USceneMapComponent>> Components;
-	Components.Reserve(MapIcons.Num());
-	if (MapIcons.GetKeys(Components))
+	for (const FMapIcon& Icon : Icons)
 	{
-		for (auto Component : Components)
+		if (Map.IsValid())
 		{
-			if (Component.IsValid())
-			{
-				Remove(Component.Get());
-			}
+			Map->UnregisterMarker(Icon.Component, MarkerLayer->GetViewMask());
+		}
+		if (Icon.Widget.IsSet())
+		{
+			DEC_DWORD_STAT(STAT_MapMarkerIconWidgets);
+		}
+	}
+	if (IconCanvas.IsValid())
+	{
+		IconCanvas->ClearIcons();
+	}
+	Icons.Empty(Slack);
+	IconIndices.Empty(Slack);
+	SweepCursor = 0;
+}
+
+void SMap::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	LastTickGeometry = AllottedGeometry;
+	SweepStaleIcons(StaleIconSweepBudget);
+
+	//Marker indices move whenever any marker is removed, so the static layer filters every frame even while its panel replays the cache
+	StaticLayer->UpdateMarkers(AllottedGeometry, InCurrentTime);
+
+	//Pan and zoom move this widget, everything else that changes static content is reported by the store or the layer
+	const uint32 StaticRevision = Map.IsValid() ? Map->GetMarkerStore().GetStaticRevision() : 0;
+	if (AllottedGeometry.AbsolutePosition != CachedPosition || AllottedGeometry.Scale != CachedScale || StaticRevision != CachedStaticRevision || StaticLayer->NeedsRepaint())
+	{
+		CachedPosition = AllottedGeometry.AbsolutePosition;
+		CachedScale = AllottedGeometry.Scale;
+		CachedStaticRevision = StaticRevision;
+		InvalidateStaticContent();
+	}
+	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+}
+
+void SMap::InvalidateStaticContent()
+{
+	if (StaticPanel.IsValid())
+	{
+		StaticPanel->InvalidateCache();
+		INC_DWORD_STAT(STAT_MapStaticContentRedraws);
+	}
+}
+
+void SMap::SweepStaleIcons(int32 Budget)
+{
+	//Components destroyed without a Remove call would otherwise keep their icon widget for the rest of the match
+	for (int32 Checked = 0; Checked < Budget && Icons.Num() > 0; ++Checked)
+	{
+		if (SweepCursor >= Icons.Num())
+		{
+			SweepCursor = 0;
+		}
+		if (!Icons[SweepCursor].Component.IsValid())
+		{
+			RemoveIconAt(SweepCursor);
+			INC_DWORD_STAT(STAT_MapStaleIconsPurged);
+		}
+		else
+		{
+			++SweepCursor;
+		}
+	}
+}
+
+void SMap::SetExplorationSource(AMapSourceVolume* Volume)
+{
+	MarkerLayer->SetExplorationSource(Volume);
+	StaticLayer->SetExplorationSource(Volume);
+	InvalidateStaticContent();
+}
+
+void SMap::SetHeatmapOverlay(FName Heatmap)
+{
+	MarkerLayer->SetHeatmapOverlay(Heatmap);
+	StaticLayer->SetHeatmapOverlay(Heatmap);
+	InvalidateStaticContent();
+}
+
+void SMap::SetActiveCategories(uint32 CategoryMask)
+{
+	MarkerLayer->SetActiveCategories(CategoryMask);
+	StaticLayer->SetActiveCategories(CategoryMask);
+	InvalidateStaticContent();
+}
+
+void SMap::SetCategoryActive(EMapMarkerCategory Category, bool bActive)
+{
+	const uint32 ActiveCategories = GetActiveCategories();
+	SetActiveCategories(bActive ? (ActiveCategories | MapCategoryToMask(Category)) : (ActiveCategories & ~MapCategoryToMask(Category)));
+}
+
+uint32 SMap::GetActiveCategories() const
+{
+	return MarkerLayer->GetActiveCategories();
+}
+
+void SMap::SetClusterSize(float NewClusterSize)
+{
+	MarkerLayer->SetClusterSize(NewClusterSize);
+	StaticLayer->SetClusterSize(NewClusterSize);
+	InvalidateStaticContent();
+}
+
+void SMap::SetZoomBand(int32 Band, float MinZoomRatio)
+{
+	MarkerLayer->SetZoomBand(Band, MinZoomRatio);
+	StaticLayer->SetZoomBand(Band, MinZoomRatio);
+	InvalidateStaticContent();
+}
+
+void SMap::SetMaxLabels(int32 NewMaxLabels)
+{
+	LabelLayer->SetMaxLabels(NewMaxLabels);
+}
+
+void SMap::RefreshLabels()
+{
+	LabelLayer->InvalidateLayout();
+}
+
+void SMap::PickMarkers(const FVector2D& ScreenPosition, TArray<USceneMapComponent*>& OutComponents) const
+{
+	if (!Map.IsValid())
+	{
+		return;
+	}
+
+	//The layers are centered and sized like this widget, so its local space is theirs
+	const FVector2D LocalPosition = LastTickGeometry.AbsoluteToLocal(ScreenPosition);
+	PickedMarkers.Reset();
+	MarkerLayer->PickMarkers(LocalPosition, PickedMarkers);
+	StaticLayer->PickMarkers(LocalPosition, PickedMarkers);
+
+	const TArray<TWeakObjectPtr<USceneMapComponent>>& Components = Map->GetMarkerStore().GetComponents();
+	for (int32 MarkerIndex : PickedMarkers)
+	{
+		if (USceneMapComponent* Component = Components[MarkerIndex].Get())
+		{
+			OutComponents.Add(Component);
 		}
-		MapIcons.Empty(Slack);
 	}
 }
 
@@ -134,15 +432,23 @@ FVector2D SMap::ComputeDesiredSize(float) const
 
 TSharedRef<SWidget> SMap::OnGenerateChildIcon(USceneMapComponent* Component, USceneCaptureComponentMap* CurrentMap) const
 {
+	TWeakObjectPtr<USceneMapComponent> WeakComponent(Component);
+	TWeakObjectPtr<USceneCaptureComponentMap> WeakMap(CurrentMap);
 	return SNew(SImage)
-		.Image(&Component->MapIcon)
-		.Visibility(this, &SMap::GetComponentVisibility, Component)
+		//Bound through the weak pointer, a component collected before the sweep reaches its icon must not be read
+		.Image_Lambda([WeakComponent]() -> const FSlateBrush*
+		{
+			return WeakComponent.IsValid() ? &WeakComponent->MapIcon : nullptr;
+		})
+		.Visibility(this, &SMap::GetComponentVisibility, WeakComponent)
 		.RenderTransformPivot(FVector2D(0.5f, 0.5f))
-		.RenderTransform_Lambda([Component]() -> FSlateRenderTransform
+		.RenderTransform_Lambda([WeakComponent, WeakMap]() -> FSlateRenderTransform
 		{
-			if (Component)
+			//The marker update quantizes the yaw, so this is a lookup into the shared rotation table
+			const int32 MarkerIndex = WeakMap.IsValid() ? WeakMap->GetMarkerStore().Find(WeakComponent.Get()) : INDEX_NONE;
+			if (MarkerIndex != INDEX_NONE)
 			{
-				return TransformCast<FSlateRenderTransform>(Concatenate(FScale2D(1.0f, 1.0f), FShear2D(0.0f, 0.0f), FQuat2D(FMath::DegreesToRadians(Component->GetComponentRotation().Yaw))));
+				return FMapMarkerStore::GetRotationTransform(WeakMap->GetMarkerStore().GetRotationSteps()[MarkerIndex]);
 			}
 			else
 			{
@@ -159,46 +465,36 @@ FVector2D SMap::WorldLocationToMap(const FVector& WorldLocation) const
 TAttribute<FVector2D> SMap::CreateComponentToMapPositionAttribute(USceneMapComponent* Component) const
 {
 	auto ThisShared = SharedThis(this);
-	return TAttribute<FVector2D>::Create([ThisShared, InputComponent]() -> FVector2D
+	TWeakObjectPtr<USceneMapComponent> InputComponent(Component);
+	return TAttribute<FVector2D>::Create(TAttribute<FVector2D>::FGetter::CreateLambda([ThisShared, InputComponent]() -> FVector2D
 	{
-		if (InputComponent)
+		const int32 MarkerIndex = ThisShared->Map.IsValid() ? ThisShared->Map->GetMarkerStore().Find(InputComponent.Get()) : INDEX_NONE;
+		if (MarkerIndex != INDEX_NONE)
 		{
-			if(InputComponent->ClampToMapEdge())
+			//Positions come from the capture's marker store rather than the component
+			const FMapMarkerStore& Markers = ThisShared->Map->GetMarkerStore();
+			const FVector2D CurrentMapLocation = Markers.GetMapLocations()[MarkerIndex];
+			if (Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge))
 			{
-				if(ThisShared->Map.IsValid())
-				{
-					auto CurrentMapLocation = ThisShared->WorldLocationToMap(InputComponent->GetComponentLocation());
-					auto ViewRect = ThisShared->Map->GetViewRect();
-					if(ViewRect.ContainsPoint(CurrentMapLocation))
-					{
-						return CurrentMapLocation;
-					}
-					else
-					{
-						auto Center = ViewRect.GetCenter();
-						auto ClampX = FMath::Clamp(CurrentMapLocation.X, Center.X - ViewRect.Left, Center.X + ViewRight.Right);
-						auto ClampY = FMath::Clamp(CurrentMapLocation.Y, Center.Y - ViewRect.Bottom, Center.Y + ViewRect.Top);
-						return FVector2D(ClampX, ClampY);
-					}
-				}
-				else
-				{
-					return FVector2D::ZeroVector;
-				}
+				const FVector2D MapSize = ThisShared->MapBrush.ImageSize;
+				return FVector2D(FMath::Clamp(CurrentMapLocation.X, 0.0f, MapSize.X), FMath::Clamp(CurrentMapLocation.Y, 0.0f, MapSize.Y));
 			}
 			else
 			{
-				return ThisShared->WorldLocationToMap(InputComponent->GetComponentLocation());
+				return CurrentMapLocation;
 			}
 		}
 		else
 		{
 			return FVector2D::ZeroVector;
 		}
-	});
+	}));
 }
 
-EVisibility SMap::GetComponentVisibility(USceneMapComponent* Component) const
+EVisibility SMap::GetComponentVisibility(TWeakObjectPtr<USceneMapComponent> Component) const
 {
-	return (!Component->bVisible || Component->bHiddenInGame) ? EVisibility::Collapsed : EVisibility::Visible;
+	USceneMapComponent* LiveComponent = Component.Get();
+	const int32 MarkerIndex = Map.IsValid() && LiveComponent ? Map->GetMarkerStore().Find(LiveComponent) : INDEX_NONE;
+	//Collapsed icons are skipped by the canvas arrange, so widgets outside the view cost nothing past this lookup
+	return MarkerLayer->IsMarkerVisible(MarkerIndex) && MarkerLayer->IsMarkerInView(MarkerIndex) ? EVisibility::Visible : EVisibility::Collapsed;
 }
\ No newline at end of file
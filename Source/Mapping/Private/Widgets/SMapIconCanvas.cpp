@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "Widgets/SMapIconCanvas.h"
+
+SMapIconCanvas::SMapIconCanvas()
+	: Children()
+	, PaintArrangedChildren(EVisibility::Visible)
+{
+}
+
+void SMapIconCanvas::Construct(const FArguments& InArgs)
+{
+}
+
+FMapIconHandle SMapIconCanvas::AddIcon(const TSharedRef<SWidget>& Widget, const TAttribute<FVector2D>& Position, const FVector2D& Size)
+{
+	FMapIconHandle Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle.Index = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle.Index = Handles.Add({ INDEX_NONE, 0 });
+	}
+	Handle.Generation = Handles[Handle.Index].Generation;
+
+	FSlot& NewSlot = *new FSlot();
+	NewSlot.Position = Position;
+	NewSlot.Size = Size;
+	NewSlot.HandleIndex = Handle.Index;
+	NewSlot.AttachWidget(Widget);
+	Handles[Handle.Index].SlotIndex = Children.Add(&NewSlot);
+	return Handle;
+}
+
+bool SMapIconCanvas::RemoveIcon(const FMapIconHandle& Handle)
+{
+	if (!IsValid(Handle))
+	{
+		return false;
+	}
+
+	//Swap the last child into the hole so nothing shifts, then point its handle at the new index
+	const int32 SlotIndex = Handles[Handle.Index].SlotIndex;
+	const int32 LastIndex = Children.Num() - 1;
+	if (SlotIndex != LastIndex)
+	{
+		Children.Swap(SlotIndex, LastIndex);
+		Handles[Children[SlotIndex].HandleIndex].SlotIndex = SlotIndex;
+	}
+	Children.RemoveAt(LastIndex);
+
+	Handles[Handle.Index].SlotIndex = INDEX_NONE;
+	++Handles[Handle.Index].Generation;
+	FreeHandles.Add(Handle.Index);
+	return true;
+}
+
+bool SMapIconCanvas::IsValid(const FMapIconHandle& Handle) const
+{
+	return Handles.IsValidIndex(Handle.Index) && Handles[Handle.Index].Generation == Handle.Generation && Handles[Handle.Index].SlotIndex != INDEX_NONE;
+}
+
+TSharedPtr<SWidget> SMapIconCanvas::GetIconWidget(const FMapIconHandle& Handle) const
+{
+	return IsValid(Handle) ? TSharedPtr<SWidget>(Children[Handles[Handle.Index].SlotIndex].GetWidget()) : TSharedPtr<SWidget>();
+}
+
+void SMapIconCanvas::ClearIcons()
+{
+	//Live handles go stale, the entries themselves are reused
+	for (int32 HandleIndex = 0; HandleIndex < Handles.Num(); ++HandleIndex)
+	{
+		if (Handles[HandleIndex].SlotIndex != INDEX_NONE)
+		{
+			Handles[HandleIndex].SlotIndex = INDEX_NONE;
+			++Handles[HandleIndex].Generation;
+			FreeHandles.Add(HandleIndex);
+		}
+	}
+	Children.Empty();
+}
+
+void SMapIconCanvas::OnArrangeChildren(const FGeometry& AllottedGeometry, FArrangedChildren& ArrangedChildren) const
+{
+	for (int32 ChildIndex = 0; ChildIndex < Children.Num(); ++ChildIndex)
+	{
+		const FSlot& CurChild = Children[ChildIndex];
+		if (ArrangedChildren.Accepts(CurChild.GetWidget()->GetVisibility()))
+		{
+			ArrangedChildren.AddWidget(AllottedGeometry.MakeChild(
+				CurChild.GetWidget(),
+				CurChild.Position.Get() - CurChild.Size * 0.5f,
+				CurChild.Size
+			));
+		}
+	}
+}
+
+int32 SMapIconCanvas::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	FArrangedChildren& ArrangedChildren = PaintArrangedChildren;
+	const int32 ArrangedMax = ArrangedChildren.GetInternalArray().Max();
+	ArrangedChildren.GetInternalArray().Reset();
+	ArrangeChildren(AllottedGeometry, ArrangedChildren);
+	if (ArrangedChildren.GetInternalArray().Max() != ArrangedMax)
+	{
+		INC_DWORD_STAT(STAT_MapPaintScratchAllocations);
+	}
+
+	int32 MaxLayerId = LayerId;
+	const FPaintArgs NewArgs = Args.WithNewParent(this);
+	for (int32 ChildIndex = 0; ChildIndex < ArrangedChildren.Num(); ++ChildIndex)
+	{
+		FArrangedWidget& CurWidget = ArrangedChildren[ChildIndex];
+
+		bool bWereOverlapping;
+		FSlateRect ChildClipRect = MyClippingRect.IntersectionWith(CurWidget.Geometry.GetClippingRect(), bWereOverlapping);
+		if (bWereOverlapping)
+		{
+			const int32 CurWidgetsMaxLayerId = CurWidget.Widget->Paint(NewArgs, CurWidget.Geometry, ChildClipRect, OutDrawElements, MaxLayerId + 1, InWidgetStyle, ShouldBeEnabled(bParentEnabled));
+			MaxLayerId = FMath::Max(MaxLayerId, CurWidgetsMaxLayerId);
+		}
+	}
+	ArrangedChildren.GetInternalArray().Reset();
+	return MaxLayerId;
+}
+
+FVector2D SMapIconCanvas::ComputeDesiredSize(float) const
+{
+	//Icons are placed in the space of whatever the canvas covers, they do not size it
+	return FVector2D::ZeroVector;
+}
+
+FChildren* SMapIconCanvas::GetChildren()
+{
+	return &Children;
+}
\ No newline at end of file
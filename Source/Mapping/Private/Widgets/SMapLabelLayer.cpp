@@ -0,0 +1,318 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "Widgets/SMapLabelLayer.h"
+#include "Widgets/SMapMarkerLayer.h"
+#include "SceneMapComponent.h"
+#include "Fonts/FontMeasure.h"
+
+DECLARE_CYCLE_STAT(TEXT("Label Layout"), STAT_MapLabelLayout, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Label Paint"), STAT_MapLabelPaint, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Label Layouts"), STAT_MapLabelLayouts, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Labels Drawn"), STAT_MapLabelsDrawn, STATGROUP_Mapping);
+
+const float SMapLabelLayer::OccupancyCellSize = 8.0f;
+
+/*Zoom bands per doubling of scale*/
+static const float LabelBandsPerOctave = 2.0f;
+
+/*Screen units between an icon and its label*/
+static const float LabelPadding = 2.0f;
+
+void SMapLabelLayer::Construct(const FArguments& InArgs)
+{
+	MapStyle = InArgs._MapStyle;
+	MarkerLayer = InArgs._MarkerLayer;
+	MaxLabels = InArgs._MaxLabels;
+	ViewZoom = InArgs._ViewZoom;
+	bHidden = true;
+	bLayoutDirty = true;
+	LayoutScale = 0.0f;
+	LayoutMarkerRevision = 0;
+	LayoutCategories = 0;
+	LayoutRect = FBox2D(ForceInit);
+	ShapedScale = 0.0f;
+	OccupancySize = FIntPoint(0, 0);
+	SetCaptureComponent(InArgs._CaptureComponent);
+}
+
+void SMapLabelLayer::SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent)
+{
+	Map = NewMapCaptureComponent;
+	Placements.Reset();
+	InvalidateLayout();
+}
+
+void SMapLabelLayer::SetMaxLabels(int32 NewMaxLabels)
+{
+	MaxLabels = NewMaxLabels;
+	InvalidateLayout();
+}
+
+void SMapLabelLayer::InvalidateLayout()
+{
+	bLayoutDirty = true;
+}
+
+int32 SMapLabelLayer::ComputeBand(float Scale)
+{
+	return Scale > 0.0f ? FMath::FloorToInt(FMath::Log2(Scale) * LabelBandsPerOctave) : 0;
+}
+
+float SMapLabelLayer::GetBandScale(int32 Band)
+{
+	return FMath::Pow(2.0f, Band / LabelBandsPerOctave);
+}
+
+void SMapLabelLayer::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	const TSharedPtr<SMapMarkerLayer> Layer = MarkerLayer.Pin();
+	const FBox2D VisibleRect = Layer.IsValid() ? Layer->GetVisibleTextureRect() : FBox2D(ForceInit);
+
+	//Clustered markers have no single icon to label, and when zoomed out that far labels would only cover the clusters
+	bHidden = !Map.IsValid() || !Layer.IsValid() || MaxLabels <= 0 || !VisibleRect.bIsValid
+		|| Layer->GetClusters().IsClustering() || Layer->GetClusters().IsAnimating((float)InCurrentTime);
+	if (!bHidden)
+	{
+		const FMapMarkerStore& Markers = Map->GetMarkerStore();
+		//Bands of the map panel when the marker layer follows them, bands of the scale otherwise
+		//The marker layer bands are in screen scale, labels are laid out in label units
+		const float LabelScale = GetLabelScale(AllottedGeometry);
+		const float BandScale = Layer->GetZoomBandScale() > 0.0f ? Layer->GetZoomBandScale() * LabelScale / AllottedGeometry.Scale : GetBandScale(ComputeBand(LabelScale));
+		const bool bNeedsLayout = bLayoutDirty
+			|| !FMath::IsNearlyEqual(BandScale, LayoutScale, BandScale * KINDA_SMALL_NUMBER)
+			|| Markers.GetMarkerRevision() != LayoutMarkerRevision
+			|| Layer->GetActiveCategories() != LayoutCategories
+			|| !LayoutRect.bIsValid || !LayoutRect.IsInside(VisibleRect.Min) || !LayoutRect.IsInside(VisibleRect.Max);
+		if (bNeedsLayout)
+		{
+			//Lay out half a view past every edge, so the view can pan a while before labels need placing again
+			const FVector2D Margin = VisibleRect.GetExtent();
+			LayoutRect = FBox2D(VisibleRect.Min - Margin, VisibleRect.Max + Margin);
+			LayoutScale = BandScale;
+			LayoutMarkerRevision = Markers.GetMarkerRevision();
+			LayoutCategories = Layer->GetActiveCategories();
+			bLayoutDirty = false;
+			LayoutLabels(Markers, LayoutRect, BandScale);
+		}
+
+		//Labels are drawn at the DPI scale, which only a new layout or a new display changes
+		const float DrawScale = AllottedGeometry.Scale / LabelScale;
+		if (bNeedsLayout || DrawScale != ShapedScale)
+		{
+			ShapeLabels(DrawScale);
+		}
+	}
+	SLeafWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+}
+
+float SMapLabelLayer::GetLabelScale(const FGeometry& AllottedGeometry) const
+{
+	const float Zoom = ViewZoom.Get();
+	return Zoom > 0.0f ? Zoom : AllottedGeometry.Scale;
+}
+
+FVector2D SMapLabelLayer::GetLabelOrigin(EMapLabelAnchor Anchor, const FVector2D& Location, const FVector2D& HalfIconSize, const FVector2D& LabelSize, float Scale)
+{
+	//Icons scale with the map and labels do not, so the icon offset is in texels and the label offset in screen units
+	switch (Anchor)
+	{
+	case EMapLabelAnchor::Left:
+		return Location + FVector2D(-HalfIconSize.X, 0.0f) + FVector2D(-LabelPadding - LabelSize.X, -LabelSize.Y * 0.5f) / Scale;
+	case EMapLabelAnchor::Above:
+		return Location + FVector2D(0.0f, -HalfIconSize.Y) + FVector2D(-LabelSize.X * 0.5f, -LabelPadding - LabelSize.Y) / Scale;
+	case EMapLabelAnchor::Below:
+		return Location + FVector2D(0.0f, HalfIconSize.Y) + FVector2D(-LabelSize.X * 0.5f, LabelPadding) / Scale;
+	case EMapLabelAnchor::Right:
+	default:
+		return Location + FVector2D(HalfIconSize.X, 0.0f) + FVector2D(LabelPadding, -LabelSize.Y * 0.5f) / Scale;
+	}
+}
+
+FVector2D SMapLabelLayer::GetHalfIconSize(const FMapMarkerStore& Markers, int32 MarkerIndex) const
+{
+	const int32 BrushId = Markers.GetBrushIds()[MarkerIndex];
+	const FSlateBrush& Brush = Markers.HasFlag(MarkerIndex, EMapMarkerFlags::Widget) ? Markers.GetSourceBrush(BrushId) : Markers.GetBrush(BrushId);
+	return Brush.ImageSize * 0.5f;
+}
+
+void SMapLabelLayer::GetCellRange(const FVector2D& Min, const FVector2D& Max, FIntPoint& OutMin, FIntPoint& OutMax) const
+{
+	//Rects that do not overlap never share a cell center, so a label right next to an icon is not blocked by it
+	OutMin = FIntPoint(FMath::RoundToInt(Min.X / OccupancyCellSize), FMath::RoundToInt(Min.Y / OccupancyCellSize));
+	OutMax = FIntPoint(FMath::RoundToInt(Max.X / OccupancyCellSize) - 1, FMath::RoundToInt(Max.Y / OccupancyCellSize) - 1);
+}
+
+bool SMapLabelLayer::IsFree(const FVector2D& Min, const FVector2D& Max) const
+{
+	FIntPoint CellMin, CellMax;
+	GetCellRange(Min, Max, CellMin, CellMax);
+	if (CellMin.X < 0 || CellMin.Y < 0 || CellMax.X >= OccupancySize.X || CellMax.Y >= OccupancySize.Y)
+	{
+		return false;
+	}
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			if (Occupancy[Y * OccupancySize.X + X])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void SMapLabelLayer::Occupy(const FVector2D& Min, const FVector2D& Max)
+{
+	FIntPoint CellMin, CellMax;
+	GetCellRange(Min, Max, CellMin, CellMax);
+	CellMin = FIntPoint(FMath::Max(CellMin.X, 0), FMath::Max(CellMin.Y, 0));
+	CellMax = FIntPoint(FMath::Min(CellMax.X, OccupancySize.X - 1), FMath::Min(CellMax.Y, OccupancySize.Y - 1));
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			Occupancy[Y * OccupancySize.X + X] = 1;
+		}
+	}
+}
+
+void SMapLabelLayer::LayoutLabels(const FMapMarkerStore& Markers, const FBox2D& TextureRect, float LayoutScale)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapLabelLayout);
+	INC_DWORD_STAT(STAT_MapLabelLayouts);
+
+	Placements.Reset();
+	const TSharedPtr<SMapMarkerLayer> Layer = MarkerLayer.Pin();
+	if (!Layer.IsValid() || !MapStyle)
+	{
+		return;
+	}
+
+	//The grid covers the layout rect in screen units at the scale laid out for
+	const FVector2D GridExtent = TextureRect.GetSize() * LayoutScale;
+	OccupancySize = FIntPoint(FMath::Max(FMath::CeilToInt(GridExtent.X / OccupancyCellSize), 1), FMath::Max(FMath::CeilToInt(GridExtent.Y / OccupancyCellSize), 1));
+	Occupancy.Reset();
+	Occupancy.SetNumZeroed(OccupancySize.X * OccupancySize.Y);
+
+	//Every icon is an obstacle, whether or not its marker gets a label. Markers clamped to the edge are drawn away from their location and not labelled
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	const TArray<TWeakObjectPtr<USceneMapComponent>>& Components = Markers.GetComponents();
+	const FVector2D Center = TextureRect.GetCenter();
+	QueryMarkers.Reset();
+	Markers.QueryRect(TextureRect, QueryMarkers);
+	Candidates.Reset();
+	for (int32 MarkerIndex : QueryMarkers)
+	{
+		if (!Layer->IsMarkerVisible(MarkerIndex) || Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge) || !TextureRect.IsInside(MapLocations[MarkerIndex]))
+		{
+			continue;
+		}
+
+		const FVector2D ScreenLocation = (MapLocations[MarkerIndex] - TextureRect.Min) * LayoutScale;
+		const FVector2D HalfIcon = GetHalfIconSize(Markers, MarkerIndex) * LayoutScale;
+		Occupy(ScreenLocation - HalfIcon, ScreenLocation + HalfIcon);
+
+		const USceneMapComponent* Component = Components[MarkerIndex].Get();
+		if (Component && !Component->MapLabel.IsEmpty())
+		{
+			Candidates.Add({ MarkerIndex, Component->MapLabelPriority, FVector2D::DistSquared(MapLocations[MarkerIndex], Center) });
+		}
+	}
+
+	//Highest priority first, and within a priority the labels nearest the view win the budget
+	Candidates.Sort([](const FLabelCandidate& A, const FLabelCandidate& B)
+	{
+		return A.Priority != B.Priority ? A.Priority > B.Priority : A.DistanceSquared < B.DistanceSquared;
+	});
+
+	const TSharedRef<FSlateFontMeasure> FontMeasure = FSlateApplication::Get().GetRenderer()->GetFontMeasureService();
+	for (const FLabelCandidate& Candidate : Candidates)
+	{
+		if (Placements.Num() >= MaxLabels)
+		{
+			break;
+		}
+
+		const FText& Text = Components[Candidate.MarkerIndex]->MapLabel;
+		const FVector2D Size = FontMeasure->Measure(Text, MapStyle->LabelFont);
+		const FVector2D HalfIcon = GetHalfIconSize(Markers, Candidate.MarkerIndex);
+		for (int32 Anchor = 0; Anchor < (int32)EMapLabelAnchor::Num; ++Anchor)
+		{
+			const FVector2D Origin = (GetLabelOrigin((EMapLabelAnchor)Anchor, MapLocations[Candidate.MarkerIndex], HalfIcon, Size, LayoutScale) - TextureRect.Min) * LayoutScale;
+			if (IsFree(Origin, Origin + Size))
+			{
+				Occupy(Origin, Origin + Size);
+				Placements.Add({ Candidate.MarkerIndex, (EMapLabelAnchor)Anchor, Size, Text, nullptr });
+				break;
+			}
+		}
+	}
+}
+
+void SMapLabelLayer::ShapeLabels(float DrawScale)
+{
+	ShapedScale = DrawScale;
+	if (!MapStyle)
+	{
+		return;
+	}
+
+	const TSharedRef<FSlateFontCache> FontCache = FSlateApplication::Get().GetRenderer()->GetFontCache();
+	for (FMapLabelPlacement& Placement : Placements)
+	{
+		const FString& String = Placement.Text.ToString();
+		Placement.ShapedText = FontCache->ShapeBidirectionalText(String, MapStyle->LabelFont, DrawScale, TextBiDi::ComputeBaseDirection(String), GetDefaultTextShapingMethod());
+	}
+}
+
+int32 SMapLabelLayer::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapLabelPaint);
+
+	const TSharedPtr<SMapMarkerLayer> Layer = MarkerLayer.Pin();
+	if (bHidden || !Map.IsValid() || !Layer.IsValid() || !MapStyle || Placements.Num() == 0)
+	{
+		return LayerId;
+	}
+
+	//Markers keep moving between layouts, so labels follow their marker at the placed side. Drawn at the inverse of the view zoom to stay the same size on screen
+	const FMapMarkerStore& Markers = Map->GetMarkerStore();
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	const float Scale = GetLabelScale(AllottedGeometry);
+	const FLinearColor Color = InWidgetStyle.GetColorAndOpacityTint() * MapStyle->LabelColor.GetColor(InWidgetStyle);
+	int32 NumDrawn = 0;
+	for (const FMapLabelPlacement& Placement : Placements)
+	{
+		if (!Placement.ShapedText.IsValid() || !MapLocations.IsValidIndex(Placement.MarkerIndex) || !Layer->IsMarkerVisible(Placement.MarkerIndex) || !Layer->IsMarkerInView(Placement.MarkerIndex))
+		{
+			continue;
+		}
+
+		const FVector2D Origin = GetLabelOrigin(Placement.Anchor, MapLocations[Placement.MarkerIndex], GetHalfIconSize(Markers, Placement.MarkerIndex), Placement.Size, Scale);
+		FSlateDrawElement::MakeShapedText(
+			OutDrawElements,
+			LayerId,
+			//The offset is given in the scaled space, so the layer space origin is scaled back up
+			AllottedGeometry.ToPaintGeometry(Origin * Scale, Placement.Size, 1.0f / Scale),
+			Placement.ShapedText.ToSharedRef(),
+			MyClippingRect,
+			ESlateDrawEffect::None,
+			Color
+		);
+		++NumDrawn;
+	}
+	INC_DWORD_STAT_BY(STAT_MapLabelsDrawn, NumDrawn);
+	return LayerId + 1;
+}
+
+FVector2D SMapLabelLayer::ComputeDesiredSize(float) const
+{
+	if (Map.IsValid() && Map->TextureTarget)
+	{
+		return FVector2D(Map->TextureTarget->SizeX, Map->TextureTarget->SizeY);
+	}
+	return FVector2D::ZeroVector;
+}
\ No newline at end of file
@@ -0,0 +1,673 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "Widgets/SMapMarkerLayer.h"
+#include "MapSourceVolume.h"
+#include "Fonts/FontMeasure.h"
+
+DECLARE_CYCLE_STAT(TEXT("Marker Layer Paint"), STAT_MapMarkerLayerPaint, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Marker Layer Gather"), STAT_MapMarkerLayerGather, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Marker Boxes"), STAT_MapMarkerBoxes, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Marker Cull Candidates"), STAT_MapMarkerCullCandidates, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Markers Culled"), STAT_MapMarkersCulled, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Marker Pick"), STAT_MapMarkerPick, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Marker Pick Candidates"), STAT_MapMarkerPickCandidates, STATGROUP_Mapping);
+
+const float SMapMarkerLayer::CullMargin = 32.0f;
+
+/*Distinct cluster member counts whose shaped text is kept*/
+static const int32 MaxCachedClusterCounts = 256;
+
+/*Geometry that maps a unit box onto the parallelogram spanned from Corner by U and V in layer space*/
+static FGeometry MakeQuadGeometry(const FGeometry& AllottedGeometry, const FVector2D& Corner, const FVector2D& U, const FVector2D& V)
+{
+	return AllottedGeometry.MakeChild(
+		FVector2D(1.0f, 1.0f),
+		FSlateLayoutTransform(Corner),
+		FSlateRenderTransform(FMatrix2x2(U.X, U.Y, V.X, V.Y)),
+		FVector2D::ZeroVector);
+}
+
+void SMapMarkerLayer::Construct(const FArguments& InArgs)
+{
+	ViewMask = 0;
+	VisibleTextureRect = FBox2D(ForceInit);
+	PaintedSize = FVector2D::ZeroVector;
+	ClusterTime = 0.0f;
+	MarkersUpdateTime = -1.0;
+	ZoomBand = INDEX_NONE;
+	ZoomBandRatio = 1.0f;
+	ZoomBandScale = 0.0f;
+	ClusterCountScale = 0.0f;
+	MapStyle = InArgs._MapStyle;
+	ClusterSize = InArgs._ClusterSize;
+	Content = InArgs._Content;
+	ViewSource = InArgs._ViewSource;
+	bPaintWidgetMarkers = InArgs._PaintWidgetMarkers;
+	bOwnsView = !ViewSource.IsValid();
+	ActiveCategories = InArgs._ActiveCategories;
+	SetCaptureComponent(InArgs._CaptureComponent);
+}
+
+SMapMarkerLayer::~SMapMarkerLayer()
+{
+	SetCaptureComponent(nullptr);
+}
+
+void SMapMarkerLayer::SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent)
+{
+	//A layer drawing another layer's view follows it, the source must be moved to the capture first
+	if (Map.IsValid() && bOwnsView)
+	{
+		Map->ReleaseMarkerView(ViewMask);
+	}
+	Map = NewMapCaptureComponent;
+	if (bOwnsView)
+	{
+		ViewMask = Map.IsValid() ? Map->AcquireMarkerView() : 0;
+	}
+	else
+	{
+		ViewMask = ViewSource.IsValid() ? ViewSource.Pin()->GetViewMask() : 0;
+	}
+	VisibleMarkers.Reset();
+	VisibleTextureRect = FBox2D(ForceInit);
+	Clusters.Reset();
+}
+
+void SMapMarkerLayer::SetExplorationSource(AMapSourceVolume* Volume)
+{
+	ExplorationSource = Volume;
+	FogBrush.SetResourceObject(nullptr);
+}
+
+void SMapMarkerLayer::SetHeatmapOverlay(FName Heatmap)
+{
+	HeatmapOverlay = Heatmap;
+	HeatmapBrush.SetResourceObject(nullptr);
+}
+
+void SMapMarkerLayer::SetActiveCategories(uint32 CategoryMask)
+{
+	ActiveCategories = CategoryMask;
+}
+
+void SMapMarkerLayer::SetClusterSize(float NewClusterSize)
+{
+	ClusterSize = NewClusterSize;
+}
+
+void SMapMarkerLayer::SetZoomBand(int32 Band, float MinZoomRatio)
+{
+	//The band scale needs the geometry, so it is taken on the next tick
+	ZoomBand = Band;
+	ZoomBandRatio = MinZoomRatio;
+	ZoomBandScale = 0.0f;
+}
+
+bool SMapMarkerLayer::IsMarkerInView(int32 MarkerIndex) const
+{
+	if (!Map.IsValid() || !VisibleTextureRect.bIsValid)
+	{
+		return true;
+	}
+	const FMapMarkerStore& Markers = Map->GetMarkerStore();
+	return !Markers.GetMapLocations().IsValidIndex(MarkerIndex) || Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge) || VisibleTextureRect.IsInside(Markers.GetMapLocations()[MarkerIndex]);
+}
+
+void SMapMarkerLayer::PickMarkers(const FVector2D& LocalPosition, TArray<int32>& OutMarkers) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapMarkerPick);
+
+	if (!Map.IsValid() || !VisibleTextureRect.bIsValid)
+	{
+		return;
+	}
+
+	//Icon widgets are shown by the icon canvas for whichever layer owns the filter
+	const FMapMarkerStore& Markers = Map->GetMarkerStore();
+	const bool bPickWidgets = Content != EMapMarkerLayerContent::Static;
+
+	//An icon covering the position has its center within the largest icon radius of it
+	float MaxRadius = MapStyle && Clusters.IsClustering() ? GetPickRadius(MapStyle->ClusterBrush) : 0.0f;
+	for (int32 BrushId = 0; BrushId < Markers.NumBrushes(); ++BrushId)
+	{
+		MaxRadius = FMath::Max(MaxRadius, GetPickRadius(Markers.GetBrush(BrushId)));
+		if (bPickWidgets)
+		{
+			MaxRadius = FMath::Max(MaxRadius, GetPickRadius(Markers.GetSourceBrush(BrushId)));
+		}
+	}
+	const FBox2D PickRect(LocalPosition - FVector2D(MaxRadius, MaxRadius), LocalPosition + FVector2D(MaxRadius, MaxRadius));
+
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	const TArray<int32>& BrushIds = Markers.GetBrushIds();
+	auto GetDrawnLocation = [this, &Markers](int32 MarkerIndex, const FVector2D& Location) -> FVector2D
+	{
+		return Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge) ? FVector2D(FMath::Clamp(Location.X, 0.0f, PaintedSize.X), FMath::Clamp(Location.Y, 0.0f, PaintedSize.Y)) : Location;
+	};
+	auto IsHit = [&LocalPosition](const FVector2D& Location, const FSlateBrush& Brush) -> bool
+	{
+		return FVector2D::DistSquared(Location, LocalPosition) <= FMath::Square(GetPickRadius(Brush));
+	};
+
+	//Markers easing out of their clusters may be drawn away from their grid cell
+	PickCandidates.Reset();
+	if (bPickWidgets || !Clusters.IsClustering())
+	{
+		Markers.QueryRect(Clusters.IsAnimating(ClusterTime) ? VisibleTextureRect : PickRect, PickCandidates);
+		INC_DWORD_STAT_BY(STAT_MapMarkerPickCandidates, PickCandidates.Num());
+	}
+
+	//Icon widgets have no stable paint order, so the one nearest the position is taken as the top one
+	if (bPickWidgets)
+	{
+		PickHits.Reset();
+		for (int32 MarkerIndex : PickCandidates)
+		{
+			if (IsPaintedByWidget(Markers, MarkerIndex) && IsMarkerVisible(MarkerIndex) && IsMarkerInView(MarkerIndex)
+				&& IsHit(GetDrawnLocation(MarkerIndex, MapLocations[MarkerIndex]), Markers.GetSourceBrush(BrushIds[MarkerIndex])))
+			{
+				PickHits.Add(MarkerIndex);
+			}
+		}
+		PickHits.Sort([&](int32 A, int32 B)
+		{
+			return FVector2D::DistSquared(GetDrawnLocation(A, MapLocations[A]), LocalPosition) < FVector2D::DistSquared(GetDrawnLocation(B, MapLocations[B]), LocalPosition);
+		});
+		OutMarkers.Append(PickHits);
+	}
+
+	//Painted markers are collected in the order GatherDrawList emits them, so the last hit of the topmost brush is the one painted on top
+	PickHits.Reset();
+	if (Clusters.IsClustering())
+	{
+		PickClusters.Reset();
+		Clusters.QueryRect(PickRect, ClusterTime, PickClusters);
+
+		//Clusters are painted after every marker, the last one painted on top
+		for (int32 Candidate = PickClusters.Num() - 1; Candidate >= 0; --Candidate)
+		{
+			const FMapMarkerCluster& Cluster = Clusters.GetClusters()[PickClusters[Candidate]];
+			const FVector2D Location = Clusters.GetDrawLocation(Cluster, ClusterTime);
+			if (Cluster.Members.Num() > 1 && MapStyle && IsHit(Location, MapStyle->ClusterBrush))
+			{
+				for (int32 MarkerIndex : Cluster.Members)
+				{
+					if (MarkerIndex < Markers.Num())
+					{
+						OutMarkers.Add(MarkerIndex);
+					}
+				}
+			}
+		}
+		for (int32 ClusterIndex : PickClusters)
+		{
+			const FMapMarkerCluster& Cluster = Clusters.GetClusters()[ClusterIndex];
+			const int32 MarkerIndex = Cluster.Members[0];
+			if (Cluster.Members.Num() == 1 && MarkerIndex < Markers.Num() && IsHit(Clusters.GetDrawLocation(Cluster, ClusterTime), Markers.GetBrush(BrushIds[MarkerIndex])))
+			{
+				PickHits.Add(MarkerIndex);
+			}
+		}
+		for (int32 MarkerIndex : Markers.GetClampedMarkers())
+		{
+			if (IsMarkerVisible(MarkerIndex) && !IsPaintedByWidget(Markers, MarkerIndex) && DrawsMarker(Markers, MarkerIndex)
+				&& IsHit(GetDrawnLocation(MarkerIndex, MapLocations[MarkerIndex]), Markers.GetBrush(BrushIds[MarkerIndex])))
+			{
+				PickHits.Add(MarkerIndex);
+			}
+		}
+	}
+	else
+	{
+		for (int32 MarkerIndex : PickCandidates)
+		{
+			const bool bPainted = IsMarkerVisible(MarkerIndex) && !IsPaintedByWidget(Markers, MarkerIndex) && DrawsMarker(Markers, MarkerIndex)
+				&& (Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge) || VisibleTextureRect.IsInside(MapLocations[MarkerIndex]));
+			if (bPainted && IsHit(GetDrawnLocation(MarkerIndex, Clusters.GetMarkerDrawLocation(MarkerIndex, MapLocations[MarkerIndex], ClusterTime)), Markers.GetBrush(BrushIds[MarkerIndex])))
+			{
+				PickHits.Add(MarkerIndex);
+			}
+		}
+	}
+
+	//Brushes are painted in ascending order and markers of one brush in gather order, reversing first keeps later markers ahead after the stable sort
+	for (int32 Low = 0, High = PickHits.Num() - 1; Low < High; ++Low, --High)
+	{
+		PickHits.Swap(Low, High);
+	}
+	PickHits.StableSort([&BrushIds](int32 A, int32 B)
+	{
+		return BrushIds[A] > BrushIds[B];
+	});
+	OutMarkers.Append(PickHits);
+}
+
+bool SMapMarkerLayer::NeedsRepaint() const
+{
+	if (Clusters.IsAnimating(ClusterTime))
+	{
+		return true;
+	}
+	if (Content == EMapMarkerLayerContent::Dynamic)
+	{
+		return false;
+	}
+
+	UTexture2D* FogTexture = ExplorationSource.IsValid() ? ExplorationSource->GetExplorationTexture() : nullptr;
+	const TSharedPtr<FMapHeatmap> Heatmap = (Map.IsValid() && !HeatmapOverlay.IsNone()) ? Map->FindHeatmap(HeatmapOverlay) : TSharedPtr<FMapHeatmap>();
+	UTexture2D* HeatmapTexture = Heatmap.IsValid() ? Heatmap->GetTexture() : nullptr;
+	return FogBrush.GetResourceObject() != FogTexture || HeatmapBrush.GetResourceObject() != HeatmapTexture;
+}
+
+void SMapMarkerLayer::UpdateMarkers(const FGeometry& AllottedGeometry, double CurrentTime)
+{
+	if (CurrentTime == MarkersUpdateTime)
+	{
+		return;
+	}
+	MarkersUpdateTime = CurrentTime;
+
+	//One pass over the packed categories so every visibility query is a lookup
+	ClusterTime = (float)CurrentTime;
+	if (Map.IsValid())
+	{
+		Map->GetMarkerStore().FilterVisible(ActiveCategories, ViewMask, VisibleMarkers);
+		if (ZoomBand != INDEX_NONE && ZoomBandScale <= 0.0f)
+		{
+			ZoomBandScale = AllottedGeometry.Scale * ZoomBandRatio;
+		}
+		UpdateClusters(Map->GetMarkerStore(), ZoomBand != INDEX_NONE ? ZoomBandScale : AllottedGeometry.Scale);
+	}
+	else
+	{
+		VisibleMarkers.Reset();
+	}
+}
+
+void SMapMarkerLayer::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	UpdateMarkers(AllottedGeometry, InCurrentTime);
+
+	//The texture is created on BeginPlay, so it may show up after the source was set
+	UTexture2D* FogTexture = ExplorationSource.IsValid() ? ExplorationSource->GetExplorationTexture() : nullptr;
+	if (FogBrush.GetResourceObject() != FogTexture)
+	{
+		FogBrush.SetResourceObject(FogTexture);
+	}
+
+	const TSharedPtr<FMapHeatmap> Heatmap = (Map.IsValid() && !HeatmapOverlay.IsNone()) ? Map->FindHeatmap(HeatmapOverlay) : TSharedPtr<FMapHeatmap>();
+	UTexture2D* HeatmapTexture = Heatmap.IsValid() ? Heatmap->GetTexture() : nullptr;
+	if (HeatmapBrush.GetResourceObject() != HeatmapTexture)
+	{
+		HeatmapBrush.SetResourceObject(HeatmapTexture);
+	}
+	SLeafWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+}
+
+void SMapMarkerLayer::UpdateClusters(const FMapMarkerStore& Markers, float Scale)
+{
+	//Icon widgets and markers clamped to the edge are always drawn on their own
+	FMapClusterFilter Filter;
+	Filter.CategoryMask = ActiveCategories;
+	Filter.ViewMask = ViewMask;
+	Filter.UnclusteredFlags = bPaintWidgetMarkers ? EMapMarkerFlags::ClampToEdge : EMapMarkerFlags::Widget | EMapMarkerFlags::ClampToEdge;
+	if (Content != EMapMarkerLayerContent::All)
+	{
+		const uint32 StaticTier = 1u << (uint32)EMapMarkerUpdateTier::Static;
+		Filter.TierMask = Content == EMapMarkerLayerContent::Static ? StaticTier : ~StaticTier;
+	}
+	Clusters.Update(Markers, Filter, FMapMarkerClusters::ComputeBand(ClusterSize, Scale), ClusterTime);
+}
+
+int32 SMapMarkerLayer::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	if (Map.IsValid())
+	{
+		if (Content != EMapMarkerLayerContent::Dynamic)
+		{
+			LayerId = PaintHeatmap(AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle);
+			LayerId = PaintFog(AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle);
+		}
+		if (Content != EMapMarkerLayerContent::Static)
+		{
+			LayerId = PaintTrails(Map->GetMarkerStore(), AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle);
+		}
+		GatherDrawList(Map->GetMarkerStore(), AllottedGeometry, MyClippingRect);
+		LayerId = PaintMarkers(Map->GetMarkerStore(), AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle);
+		LayerId = PaintClusters(AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle);
+	}
+	return LayerId;
+}
+
+int32 SMapMarkerLayer::PaintHeatmap(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const
+{
+	if (!HeatmapBrush.GetResourceObject())
+	{
+		return LayerId;
+	}
+
+	const TSharedPtr<FMapHeatmap> Heatmap = Map->FindHeatmap(HeatmapOverlay);
+	if (!Heatmap.IsValid())
+	{
+		return LayerId;
+	}
+
+	//The heatmap covers the texture as it was when bound, so carry its corners through the world onto the current texture
+	const FVector2D& Size = Heatmap->GetTextureSize();
+	const FMapProjection Projection = Map->GetMapProjection();
+	FVector2D Corner = FVector2D::ZeroVector;
+	FVector2D U(Size.X, 0.0f);
+	FVector2D V(0.0f, Size.Y);
+	if (!Projection.Equals(Heatmap->GetProjection()))
+	{
+		const FMapProjection& Bound = Heatmap->GetProjection();
+		FVector P00, P10, P01;
+		if (!Projection.Project(Bound.Deproject(Corner), P00) || !Projection.Project(Bound.Deproject(U), P10) || !Projection.Project(Bound.Deproject(V), P01))
+		{
+			return LayerId;
+		}
+		Corner = FVector2D(P00.X, P00.Y);
+		U = FVector2D(P10.X, P10.Y) - Corner;
+		V = FVector2D(P01.X, P01.Y) - Corner;
+	}
+
+	FSlateDrawElement::MakeBox(
+		OutDrawElements,
+		LayerId,
+		MakeQuadGeometry(AllottedGeometry, Corner, U, V).ToPaintGeometry(),
+		&HeatmapBrush,
+		MyClippingRect,
+		ESlateDrawEffect::None,
+		InWidgetStyle.GetColorAndOpacityTint()
+	);
+	return LayerId + 1;
+}
+
+int32 SMapMarkerLayer::PaintFog(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const
+{
+	if (!ExplorationSource.IsValid() || !FogBrush.GetResourceObject())
+	{
+		return LayerId;
+	}
+
+	FVector Origin, AxisX, AxisY;
+	ExplorationSource->GetExplorationQuad(Origin, AxisX, AxisY);
+
+	const FMapProjection Projection = Map->GetMapProjection();
+	FVector P00, P10, P01;
+	if (!Projection.Project(Origin, P00) || !Projection.Project(Origin + AxisX, P10) || !Projection.Project(Origin + AxisY, P01))
+	{
+		return LayerId;
+	}
+
+	//A unit box transformed onto the projected grid, exact for the orthographic top down captures maps use
+	const FVector2D Corner(P00.X, P00.Y);
+	const FGeometry FogGeometry = MakeQuadGeometry(AllottedGeometry, Corner, FVector2D(P10.X, P10.Y) - Corner, FVector2D(P01.X, P01.Y) - Corner);
+
+	FSlateDrawElement::MakeBox(
+		OutDrawElements,
+		LayerId,
+		FogGeometry.ToPaintGeometry(),
+		&FogBrush,
+		MyClippingRect,
+		ESlateDrawEffect::None,
+		InWidgetStyle.GetColorAndOpacityTint() * ExplorationSource->GetExplorationFogColor()
+	);
+	return LayerId + 1;
+}
+
+void SMapMarkerLayer::GatherDrawList(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapMarkerLayerGather);
+
+	//The layer is laid out in texture space, so the clip rect brought into local space is the visible part of the texture.
+	//Grow it by the largest icon so a box whose center is just outside still paints its visible half
+	float MaxIconExtent = MapStyle && Clusters.IsClustering() ? MapStyle->ClusterBrush.ImageSize.Size() * 0.5f : 0.0f;
+	for (int32 BrushId = 0; BrushId < Markers.NumBrushes(); ++BrushId)
+	{
+		MaxIconExtent = FMath::Max(MaxIconExtent, Markers.GetBrush(BrushId).ImageSize.Size() * 0.5f);
+	}
+	const FVector2D Extent(MaxIconExtent + CullMargin, MaxIconExtent + CullMargin);
+	VisibleTextureRect = FBox2D(AllottedGeometry.AbsoluteToLocal(MyClippingRect.GetTopLeft()) - Extent, AllottedGeometry.AbsoluteToLocal(MyClippingRect.GetBottomRight()) + Extent);
+	PaintedSize = AllottedGeometry.GetLocalSize();
+
+	//Visibility is from Tick, a marker removed since then may have left an index past the filter
+	const TArray<FVector2D>& MapLocations = Markers.GetMapLocations();
+	CandidateMarkers.Reset();
+	CandidateLocations.Reset();
+	VisibleClusters.Reset();
+	if (Clusters.IsClustering())
+	{
+		//Clusters of one draw as their marker, so only cells on screen ever produce a box
+		const TArray<FMapMarkerCluster>& AllClusters = Clusters.GetClusters();
+		for (int32 ClusterIndex = 0; ClusterIndex < AllClusters.Num(); ++ClusterIndex)
+		{
+			const FMapMarkerCluster& Cluster = AllClusters[ClusterIndex];
+			const FVector2D Location = Clusters.GetDrawLocation(Cluster, ClusterTime);
+			if (!VisibleTextureRect.IsInside(Location))
+			{
+				continue;
+			}
+			if (Cluster.Members.Num() > 1)
+			{
+				VisibleClusters.Add(ClusterIndex);
+			}
+			else if (Cluster.Members[0] < Markers.Num())
+			{
+				CandidateMarkers.Add(Cluster.Members[0]);
+				CandidateLocations.Add(Location);
+			}
+		}
+		for (int32 MarkerIndex : Markers.GetClampedMarkers())
+		{
+			if (IsMarkerVisible(MarkerIndex) && !IsPaintedByWidget(Markers, MarkerIndex) && DrawsMarker(Markers, MarkerIndex))
+			{
+				CandidateMarkers.Add(MarkerIndex);
+				CandidateLocations.Add(MapLocations[MarkerIndex]);
+			}
+		}
+	}
+	else
+	{
+		Markers.QueryRect(VisibleTextureRect, CandidateMarkers);
+		INC_DWORD_STAT_BY(STAT_MapMarkerCullCandidates, CandidateMarkers.Num());
+		INC_DWORD_STAT_BY(STAT_MapMarkersCulled, Markers.Num() - CandidateMarkers.Num());
+
+		int32 NumPainted = 0;
+		for (int32 Candidate = 0; Candidate < CandidateMarkers.Num(); ++Candidate)
+		{
+			const int32 MarkerIndex = CandidateMarkers[Candidate];
+			const bool bPaint = IsMarkerVisible(MarkerIndex) && !IsPaintedByWidget(Markers, MarkerIndex) && DrawsMarker(Markers, MarkerIndex)
+				&& (Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge) || VisibleTextureRect.IsInside(MapLocations[MarkerIndex]));
+			if (bPaint)
+			{
+				CandidateMarkers[NumPainted++] = MarkerIndex;
+				CandidateLocations.Add(Clusters.GetMarkerDrawLocation(MarkerIndex, MapLocations[MarkerIndex], ClusterTime));
+			}
+		}
+		CandidateMarkers.SetNum(NumPainted, false);
+	}
+
+	//Counting sort of the markers to paint by brush, so consecutive boxes share a texture and batch. DrawOrder holds candidate slots
+	const TArray<int32>& BrushIds = Markers.GetBrushIds();
+	BrushStarts.Reset();
+	BrushStarts.SetNumZeroed(Markers.NumBrushes() + 1);
+	for (int32 MarkerIndex : CandidateMarkers)
+	{
+		++BrushStarts[BrushIds[MarkerIndex] + 1];
+	}
+	for (int32 BrushId = 1; BrushId < BrushStarts.Num(); ++BrushId)
+	{
+		BrushStarts[BrushId] += BrushStarts[BrushId - 1];
+	}
+	DrawOrder.SetNumUninitialized(CandidateMarkers.Num(), false);
+	for (int32 Candidate = 0; Candidate < CandidateMarkers.Num(); ++Candidate)
+	{
+		DrawOrder[BrushStarts[BrushIds[CandidateMarkers[Candidate]]]++] = Candidate;
+	}
+	//The scatter advanced every start to the next brush's start, shift them back
+	for (int32 BrushId = Markers.NumBrushes(); BrushId > 0; --BrushId)
+	{
+		BrushStarts[BrushId] = BrushStarts[BrushId - 1];
+	}
+	BrushStarts[0] = 0;
+}
+
+int32 SMapMarkerLayer::PaintMarkers(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MapMarkerLayerPaint);
+
+	const TArray<uint8>& RotationSteps = Markers.GetRotationSteps();
+	const FVector2D MapSize = AllottedGeometry.GetLocalSize();
+	const FLinearColor Tint = InWidgetStyle.GetColorAndOpacityTint();
+	for (int32 BrushId = 0; BrushId < Markers.NumBrushes(); ++BrushId)
+	{
+		const FSlateBrush& Brush = Markers.GetBrush(BrushId);
+		const FVector2D HalfSize = Brush.ImageSize * 0.5f;
+		const FLinearColor BrushTint = Tint * Brush.GetTint(InWidgetStyle);
+		for (int32 Slot = BrushStarts[BrushId]; Slot < BrushStarts[BrushId + 1]; ++Slot)
+		{
+			const int32 MarkerIndex = CandidateMarkers[DrawOrder[Slot]];
+			FVector2D Location = CandidateLocations[DrawOrder[Slot]];
+			if (Markers.HasFlag(MarkerIndex, EMapMarkerFlags::ClampToEdge))
+			{
+				Location = FVector2D(FMath::Clamp(Location.X, 0.0f, MapSize.X), FMath::Clamp(Location.Y, 0.0f, MapSize.Y));
+			}
+
+			FSlateDrawElement::MakeRotatedBox(
+				OutDrawElements,
+				LayerId,
+				AllottedGeometry.ToPaintGeometry(Location - HalfSize, Brush.ImageSize),
+				&Brush,
+				MyClippingRect,
+				ESlateDrawEffect::None,
+				FMapMarkerStore::GetRotationAngle(RotationSteps[MarkerIndex]),
+				TOptional<FVector2D>(),
+				FSlateDrawElement::RelativeToElement,
+				BrushTint
+			);
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_MapMarkerBoxes, DrawOrder.Num());
+	return LayerId + 1;
+}
+
+int32 SMapMarkerLayer::PaintClusters(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const
+{
+	if (!MapStyle || VisibleClusters.Num() == 0)
+	{
+		return LayerId;
+	}
+
+	//Every icon goes on one layer and every count on the next, so each batches into one draw
+	const FSlateBrush& Brush = MapStyle->ClusterBrush;
+	const FVector2D HalfSize = Brush.ImageSize * 0.5f;
+	const FLinearColor Tint = InWidgetStyle.GetColorAndOpacityTint();
+
+	//Counts are shaped for the scale they are drawn at, so only zooming shapes them again
+	const float Scale = AllottedGeometry.Scale;
+	if (Scale != ClusterCountScale)
+	{
+		ClusterCountTexts.Reset();
+		ClusterCountScale = Scale;
+	}
+	for (int32 ClusterIndex : VisibleClusters)
+	{
+		const FMapMarkerCluster& Cluster = Clusters.GetClusters()[ClusterIndex];
+		const FVector2D Location = Clusters.GetDrawLocation(Cluster, ClusterTime);
+		FSlateDrawElement::MakeBox(
+			OutDrawElements,
+			LayerId,
+			AllottedGeometry.ToPaintGeometry(Location - HalfSize, Brush.ImageSize),
+			&Brush,
+			MyClippingRect,
+			ESlateDrawEffect::None,
+			Tint * Brush.GetTint(InWidgetStyle)
+		);
+
+		//Only counts actually drawn are kept, and the cache starts over if cluster sizes wander through too many of them.
+		//The draw element shares the shaped glyphs where a text element would copy the string on every paint
+		const FShapedGlyphSequencePtr* CachedCount = ClusterCountTexts.Find(Cluster.Members.Num());
+		if (!CachedCount)
+		{
+			if (ClusterCountTexts.Num() >= MaxCachedClusterCounts)
+			{
+				ClusterCountTexts.Reset();
+			}
+			const FShapedGlyphSequenceRef Shaped = FSlateApplication::Get().GetRenderer()->GetFontCache()->ShapeBidirectionalText(
+				FString::FromInt(Cluster.Members.Num()), MapStyle->ClusterFont, Scale, TextBiDi::ETextDirection::LeftToRight, GetDefaultTextShapingMethod());
+			CachedCount = &ClusterCountTexts.Add(Cluster.Members.Num(), Shaped);
+			INC_DWORD_STAT(STAT_MapPaintScratchAllocations);
+		}
+		const FShapedGlyphSequenceRef Count = CachedCount->ToSharedRef();
+		const FVector2D TextSize = FVector2D(Count->GetMeasuredWidth(), Count->GetMaxTextHeight()) / Scale;
+		FSlateDrawElement::MakeShapedText(
+			OutDrawElements,
+			LayerId + 1,
+			AllottedGeometry.ToPaintGeometry(Location - TextSize * 0.5f, TextSize),
+			Count,
+			MyClippingRect,
+			ESlateDrawEffect::None,
+			Tint
+		);
+	}
+	INC_DWORD_STAT_BY(STAT_MapMarkerBoxes, VisibleClusters.Num());
+	return LayerId + 2;
+}
+
+int32 SMapMarkerLayer::PaintTrails(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const
+{
+	if (!MapStyle)
+	{
+		return LayerId;
+	}
+
+	//Line elements copy their points into the draw list on every paint, a box per segment copies nothing and still batches into one draw
+	const FSlateBrush& Brush = MapStyle->TrailBrush;
+	const float Thickness = Brush.ImageSize.Y / AllottedGeometry.Scale;
+	const FVector2D RotationPoint(0.0f, Thickness * 0.5f);
+	const FLinearColor Tint = InWidgetStyle.GetColorAndOpacityTint() * Brush.GetTint(InWidgetStyle);
+	for (int32 TrailSlot = 0; TrailSlot < Markers.NumTrails(); ++TrailSlot)
+	{
+		const FMapTrail& Trail = Markers.GetTrail(TrailSlot);
+		if (Trail.Num() < 2 || !IsMarkerVisible(Markers.GetTrailMarker(TrailSlot)))
+		{
+			continue;
+		}
+
+		const FLinearColor TrailTint = Tint * Trail.GetColor();
+		for (int32 Point = 1; Point < Trail.Num(); ++Point)
+		{
+			const FVector2D& Start = Trail.GetMapPoint(Point - 1);
+			const FVector2D Segment = Trail.GetMapPoint(Point) - Start;
+			if (Segment.IsNearlyZero())
+			{
+				continue;
+			}
+			FSlateDrawElement::MakeRotatedBox(
+				OutDrawElements,
+				LayerId,
+				AllottedGeometry.ToPaintGeometry(Start - RotationPoint, FVector2D(Segment.Size(), Thickness)),
+				&Brush,
+				MyClippingRect,
+				ESlateDrawEffect::None,
+				FMath::Atan2(Segment.Y, Segment.X),
+				RotationPoint,
+				FSlateDrawElement::RelativeToElement,
+				TrailTint
+			);
+		}
+	}
+	return LayerId + 1;
+}
+
+FVector2D SMapMarkerLayer::ComputeDesiredSize(float) const
+{
+	if (Map.IsValid() && Map->TextureTarget)
+	{
+		return FVector2D(Map->TextureTarget->SizeX, Map->TextureTarget->SizeY);
+	}
+	return FVector2D::ZeroVector;
+}
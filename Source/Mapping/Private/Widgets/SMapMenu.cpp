@@ -23,6 +23,8 @@ void SMapMenu::Construct(const FArguments& InArgs)
 	FooterVisibility = InArgs._FooterVisibility;
 	LeftSidebarVisibility = InArgs._LeftSidebarVisibility;
 	RightSidebarVisibility = InArgs._RightSidebarVisibility;
+	OnMarkersHovered = InArgs._OnMarkersHovered;
+	OnMarkersSelected = InArgs._OnMarkersSelected;
 	
 
 	ChildSlot
@@ -63,12 +65,17 @@ void SMapMenu::Construct(const FArguments& InArgs)
 			[
 				SAssignNew(MapPanel, SPanZoomPanel)
 				.MapStyle(InArgs._MapStyle)
+				.OnPointerHovered(this, &SMapMenu::HandlePanelHovered)
+				.OnPointerClicked(this, &SMapMenu::HandlePanelClicked)
+				.OnPointerLeft(this, &SMapMenu::HandlePanelLeft)
 				+ SPanZoomPanel::Slot()
 				.Position(FVector2D(0.0f, 0.0f))
 				.Order(0)
 				[
 					SAssignNew(Map, SMap)
 					.CaptureComponent(InArgs._MapCaptureComponent)
+					.MapStyle(InArgs._MapStyle)
+					.ViewZoom(this, &SMapMenu::GetZoom)
 				]
 			]
 			+ SHorizontalBox::Slot()
@@ -97,9 +104,21 @@ void SMapMenu::Construct(const FArguments& InArgs)
 			]
 		]
 	];	
+
+	MapPanel->OnZoomBandChanged().AddSP(this, &SMapMenu::HandleZoomBandChanged);
 }
 END_SLATE_FUNCTION_BUILD_OPTIMIZATION
 
+void SMapMenu::HandleZoomBandChanged(int32 NewBand, int32 OldBand)
+{
+	//The map lays clusters and labels out once per band, for the smallest zoom of the band so zooming within it only spreads them
+	if (Map.IsValid())
+	{
+		const float Zoom = MapPanel->GetZoom();
+		Map->SetZoomBand(NewBand, Zoom > 0.0f ? MapPanel->GetZoomBandMinZoom(NewBand) / Zoom : 1.0f);
+	}
+}
+
 float SMapMenu::GetZoom() const
 {
 	if (MapPanel.IsValid())
@@ -176,11 +195,63 @@ void SMapMenu::SetZoomRanges(float Min, float Max, const TArray<float>& Ranges)
 	}
 }
 
+void SMapMenu::SetZoomBands(const TArray<FPanZoomBand>& Bands, float Hysteresis)
+{
+	if (MapPanel.IsValid())
+	{
+		MapPanel->SetZoomBands(Bands, Hysteresis);
+	}
+}
+
+void SMapMenu::SetDirectManipulation(bool bEnabled, float PredictionTime, float InertiaFriction)
+{
+	if (MapPanel.IsValid())
+	{
+		MapPanel->SetDirectManipulation(bEnabled, PredictionTime, InertiaFriction);
+	}
+}
+
+int32 SMapMenu::GetZoomBand() const
+{
+	return MapPanel.IsValid() ? MapPanel->GetZoomBand() : INDEX_NONE;
+}
+
+FName SMapMenu::GetZoomBandName() const
+{
+	return MapPanel.IsValid() ? MapPanel->GetZoomBandName() : NAME_None;
+}
+
+FOnPanZoomBandChanged& SMapMenu::OnZoomBandChanged()
+{
+	return MapPanel->OnZoomBandChanged();
+}
+
 SPanZoomPanel::FSlot& SMapMenu::AddSlot()
 {
 	return MapPanel->AddSlot();
 }
 
+SPanZoomPanel::FSlot& SMapMenu::AddSlot(int32 Order)
+{
+	return MapPanel->AddSlot(Order);
+}
+
+void SMapMenu::BeginBatch()
+{
+	if (MapPanel.IsValid())
+	{
+		MapPanel->BeginBatch();
+	}
+}
+
+void SMapMenu::EndBatch()
+{
+	if (MapPanel.IsValid())
+	{
+		MapPanel->EndBatch();
+	}
+}
+
 void SMapMenu::RemoveSlot(TSharedRef<SWidget> Widget)
 {
 	if (MapPanel.IsValid())
@@ -189,6 +260,11 @@ void SMapMenu::RemoveSlot(TSharedRef<SWidget> Widget)
 	}
 }
 
+bool SMapMenu::RemoveSlot(const FPanZoomSlotHandle& Handle)
+{
+	return MapPanel.IsValid() && MapPanel->RemoveSlot(Handle);
+}
+
 void SMapMenu::SetHeaderVisibility(TAttribute<EVisibility> NewVisibility)
 {
 	HeaderVisibility = NewVisibility;
@@ -236,4 +312,90 @@ void SMapMenu::RemoveAll()
 void SMapMenu::SetAll(const TArray<USceneMapComponent*>& NewSceneComponents)
 {
 	Map->SetAll(NewSceneComponents);
+}
+
+void SMapMenu::SetExplorationSource(AMapSourceVolume* Volume)
+{
+	Map->SetExplorationSource(Volume);
+}
+
+void SMapMenu::SetHeatmapOverlay(FName Heatmap)
+{
+	Map->SetHeatmapOverlay(Heatmap);
+}
+
+void SMapMenu::SetActiveCategories(uint32 CategoryMask)
+{
+	Map->SetActiveCategories(CategoryMask);
+}
+
+void SMapMenu::SetCategoryActive(EMapMarkerCategory Category, bool bActive)
+{
+	Map->SetCategoryActive(Category, bActive);
+}
+
+uint32 SMapMenu::GetActiveCategories() const
+{
+	return Map->GetActiveCategories();
+}
+
+void SMapMenu::SetClusterSize(float NewClusterSize)
+{
+	Map->SetClusterSize(NewClusterSize);
+}
+
+void SMapMenu::SetMaxLabels(int32 NewMaxLabels)
+{
+	Map->SetMaxLabels(NewMaxLabels);
+}
+
+void SMapMenu::RefreshLabels()
+{
+	Map->RefreshLabels();
+}
+
+void SMapMenu::PickMarkers(const FVector2D& PanelPosition, TArray<USceneMapComponent*>& OutComponents) const
+{
+	if (MapPanel.IsValid() && Map.IsValid())
+	{
+		Map->PickMarkers(MapPanel->ToScreenPosition(PanelPosition), OutComponents);
+	}
+}
+
+void SMapMenu::HandlePanelHovered(const FVector2D& PanelPosition)
+{
+	PickedMarkers.Reset();
+	PickMarkers(PanelPosition, PickedMarkers);
+	SetHoveredMarkers(PickedMarkers);
+}
+
+void SMapMenu::HandlePanelClicked(const FVector2D& PanelPosition)
+{
+	PickedMarkers.Reset();
+	PickMarkers(PanelPosition, PickedMarkers);
+	OnMarkersSelected.ExecuteIfBound(PickedMarkers);
+}
+
+void SMapMenu::HandlePanelLeft()
+{
+	PickedMarkers.Reset();
+	SetHoveredMarkers(PickedMarkers);
+}
+
+void SMapMenu::SetHoveredMarkers(const TArray<USceneMapComponent*>& Components)
+{
+	bool bChanged = Components.Num() != HoveredMarkers.Num();
+	for (int32 Index = 0; !bChanged && Index < Components.Num(); ++Index)
+	{
+		bChanged = HoveredMarkers[Index].Get() != Components[Index];
+	}
+	if (bChanged)
+	{
+		HoveredMarkers.Reset();
+		for (USceneMapComponent* Component : Components)
+		{
+			HoveredMarkers.Add(Component);
+		}
+		OnMarkersHovered.ExecuteIfBound(Components);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,243 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappingPrivatePCH.h"
+#include "Widgets/SMiniMap.h"
+#include "Widgets/SMapMarkerLayer.h"
+#include "SceneMapComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Minimap Paint"), STAT_MiniMapPaint, STATGROUP_Mapping);
+
+void SMiniMap::Construct(const FArguments& InArgs)
+{
+	MapStyle = InArgs._MapStyle;
+	Size = InArgs._Size;
+	Zoom = FMath::Max(InArgs._Zoom, KINDA_SMALL_NUMBER);
+	ViewCenter = FVector2D::ZeroVector;
+	bFollowTargetAdded = false;
+
+	//Icon widgets would double the widgets of a full map open at the same time, here their markers are painted like all others
+	ChildSlot
+		[
+			SAssignNew(MarkerLayer, SMapMarkerLayer)
+			.ActiveCategories(InArgs._ActiveCategories)
+			.MapStyle(InArgs._MapStyle)
+			.ClusterSize(InArgs._ClusterSize)
+			.PaintWidgetMarkers(true)
+		];
+
+	SetCaptureComponent(InArgs._CaptureComponent);
+	SetFollowTarget(InArgs._FollowTarget);
+}
+
+SMiniMap::~SMiniMap()
+{
+	RemoveAll();
+	MarkerLayer->SetCaptureComponent(nullptr);
+}
+
+void SMiniMap::SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent)
+{
+	if (Map.IsValid())
+	{
+		for (const TWeakObjectPtr<USceneMapComponent>& Component : Components)
+		{
+			Map->UnregisterMarker(Component, MarkerLayer->GetViewMask());
+		}
+	}
+	MarkerLayer->SetCaptureComponent(NewMapCaptureComponent);
+	if (NewMapCaptureComponent)
+	{
+		for (const TWeakObjectPtr<USceneMapComponent>& Component : Components)
+		{
+			NewMapCaptureComponent->RegisterMarker(Component.Get(), MarkerLayer->GetViewMask());
+		}
+	}
+
+	Map = NewMapCaptureComponent;
+	if (Map.IsValid() && Map->TextureTarget && Map->GetMaterialInstance())
+	{
+		MapBrush.SetResourceObject(Map->GetMaterialInstance());
+		MapBrush.DrawAs = ESlateBrushDrawType::Image;
+		MapBrush.ImageSize.X = Map->TextureTarget->SizeX;
+		MapBrush.ImageSize.Y = Map->TextureTarget->SizeY;
+	}
+	else
+	{
+		MapBrush.SetResourceObject(nullptr);
+		MapBrush.ImageSize = FVector2D::ZeroVector;
+		MapBrush.DrawAs = ESlateBrushDrawType::NoDrawType;
+	}
+	if (!FollowTarget.IsValid())
+	{
+		ViewCenter = MapBrush.ImageSize * 0.5f;
+	}
+}
+
+void SMiniMap::Add(USceneMapComponent* Component)
+{
+	//Added on its own as well now, so it stays when following stops
+	if (Component && Component == FollowTarget.Get())
+	{
+		bFollowTargetAdded = false;
+	}
+	if (Component && !Components.Contains(Component))
+	{
+		Components.Add(Component);
+		if (Map.IsValid())
+		{
+			Map->RegisterMarker(Component, MarkerLayer->GetViewMask());
+		}
+	}
+}
+
+void SMiniMap::Remove(USceneMapComponent* Component)
+{
+	//Matched by index and serial so a component already pending kill is still found
+	const TWeakObjectPtr<USceneMapComponent> Key(Component);
+	const int32 Index = Component ? Components.IndexOfByPredicate([&Key](const TWeakObjectPtr<USceneMapComponent>& Existing) { return Existing.HasSameIndexAndSerialNumber(Key); }) : INDEX_NONE;
+	if (Index != INDEX_NONE)
+	{
+		if (Map.IsValid())
+		{
+			Map->UnregisterMarker(Component, MarkerLayer->GetViewMask());
+		}
+		Components.RemoveAtSwap(Index, 1, false);
+		if (FollowTarget.HasSameIndexAndSerialNumber(Key))
+		{
+			bFollowTargetAdded = false;
+		}
+	}
+}
+
+void SMiniMap::RemoveAll()
+{
+	if (Map.IsValid())
+	{
+		for (const TWeakObjectPtr<USceneMapComponent>& Component : Components)
+		{
+			Map->UnregisterMarker(Component, MarkerLayer->GetViewMask());
+		}
+	}
+	Components.Empty();
+	bFollowTargetAdded = false;
+}
+
+void SMiniMap::SetFollowTarget(USceneMapComponent* Component)
+{
+	if (Component == FollowTarget.Get() && Component)
+	{
+		return;
+	}
+	StopFollowing();
+	FollowTarget = Component;
+	if (Component && !Components.Contains(Component))
+	{
+		Add(Component);
+		bFollowTargetAdded = true;
+	}
+}
+
+void SMiniMap::StopFollowing()
+{
+	//Only a target added for following is removed, one added by the owner stays on the minimap
+	if (bFollowTargetAdded)
+	{
+		const int32 Index = Components.IndexOfByPredicate([this](const TWeakObjectPtr<USceneMapComponent>& Existing) { return Existing.HasSameIndexAndSerialNumber(FollowTarget); });
+		if (Index != INDEX_NONE)
+		{
+			if (Map.IsValid())
+			{
+				Map->UnregisterMarker(FollowTarget, MarkerLayer->GetViewMask());
+			}
+			Components.RemoveAtSwap(Index, 1, false);
+		}
+		bFollowTargetAdded = false;
+	}
+	FollowTarget = nullptr;
+}
+
+void SMiniMap::SetViewCenter(const FVector2D& TexturePosition)
+{
+	StopFollowing();
+	ViewCenter = TexturePosition;
+}
+
+void SMiniMap::SetZoom(float NewZoom)
+{
+	Zoom = FMath::Max(NewZoom, KINDA_SMALL_NUMBER);
+}
+
+void SMiniMap::SetActiveCategories(uint32 CategoryMask)
+{
+	MarkerLayer->SetActiveCategories(CategoryMask);
+}
+
+void SMiniMap::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	//The followed component is projected with every other marker, so following is a lookup rather than a projection of its own
+	if (FollowTarget.IsValid() && Map.IsValid())
+	{
+		const FMapMarkerStore& Markers = Map->GetMarkerStore();
+		const int32 MarkerIndex = Markers.Find(FollowTarget.Get());
+		if (MarkerIndex != INDEX_NONE)
+		{
+			ViewCenter = Markers.GetMapLocations()[MarkerIndex];
+		}
+	}
+	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+}
+
+FGeometry SMiniMap::MakeMapGeometry(const FGeometry& AllottedGeometry) const
+{
+	return AllottedGeometry.MakeChild(AllottedGeometry.GetLocalSize() * 0.5f / Zoom - ViewCenter, MapBrush.ImageSize, Zoom);
+}
+
+void SMiniMap::OnArrangeChildren(const FGeometry& AllottedGeometry, FArrangedChildren& ArrangedChildren) const
+{
+	if (ArrangedChildren.Accepts(MarkerLayer->GetVisibility()))
+	{
+		ArrangedChildren.AddWidget(FArrangedWidget(MarkerLayer.ToSharedRef(), MakeMapGeometry(AllottedGeometry)));
+	}
+}
+
+int32 SMiniMap::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MiniMapPaint);
+	const FGeometry MapGeometry = MakeMapGeometry(AllottedGeometry);
+	FSlateDrawElement::MakeBox(
+		OutDrawElements,
+		LayerId,
+		MapGeometry.ToPaintGeometry(),
+		&MapBrush,
+		MyClippingRect,
+		ESlateDrawEffect::None,
+		InWidgetStyle.GetColorAndOpacityTint()
+	);
+
+	//The layer culls to the clip rect, so only the markers under the minimap are gathered and painted
+	int32 MaxLayerId = LayerId;
+	if (MarkerLayer->GetVisibility().IsVisible())
+	{
+		MaxLayerId = MarkerLayer->Paint(Args.WithNewParent(this), MapGeometry, MyClippingRect, OutDrawElements, LayerId + 1, InWidgetStyle, ShouldBeEnabled(bParentEnabled));
+	}
+
+	if (MapStyle)
+	{
+		++MaxLayerId;
+		FSlateDrawElement::MakeBox(
+			OutDrawElements,
+			MaxLayerId,
+			AllottedGeometry.ToPaintGeometry(),
+			&MapStyle->MinimapMaskBrush,
+			MyClippingRect,
+			ESlateDrawEffect::None,
+			InWidgetStyle.GetColorAndOpacityTint() * MapStyle->MinimapMaskBrush.GetTint(InWidgetStyle)
+		);
+	}
+	return MaxLayerId;
+}
+
+FVector2D SMiniMap::ComputeDesiredSize(float) const
+{
+	return Size;
+}
\ No newline at end of file
@@ -7,6 +7,26 @@
 #include "SlateCore.h"
 #include "IPluginManager.h"
 
+DECLARE_CYCLE_STAT(TEXT("Pan Zoom Item Update"), STAT_PanZoomItemUpdate, STATGROUP_Mapping);
+DECLARE_CYCLE_STAT(TEXT("Pan Zoom Item Grid Rebuild"), STAT_PanZoomItemGridRebuild, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Realized Items"), STAT_PanZoomRealizedItems, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Slot Sorts"), STAT_PanZoomSlotSorts, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Animating Views"), STAT_PanZoomAnimatingViews, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Band Changes"), STAT_PanZoomBandChanges, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Input Events"), STAT_PanZoomInputEvents, STATGROUP_Mapping);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pan Zoom Input Applies"), STAT_PanZoomInputApplies, STATGROUP_Mapping);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pan Zoom Input Latency Frames"), STAT_PanZoomInputLatencyFrames, STATGROUP_Mapping);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Pan Zoom Input Latency ms"), STAT_PanZoomInputLatencyMs, STATGROUP_Mapping);
+
+/*Drag speed in view units per second below which a thrown view stops*/
+static const float MinPanVelocity = 1.0f;
+
+/*Frames a pan input is followed for before its latency measurement is given up*/
+static const uint64 MaxLatencyFrames = 60;
+
+/*Smallest side of an item grid cell in view units*/
+static const float MinItemCellSize = 64.0f;
+
 SPanZoomPanel::~SPanZoomPanel()
 {
 
@@ -14,10 +34,40 @@ SPanZoomPanel::~SPanZoomPanel()
 
 SPanZoomPanel::SPanZoomPanel()
 	: Children()
+	, PaintArrangedChildren(EVisibility::Visible)
+	, bChildrenUnsorted(false)
+	, BatchDepth(0)
 	, MapStyle(nullptr)
 	, bIsPanning(false)
 	, bIsClicking(false)
 	, bIsZooming(false)
+	, bIsDragging(false)
+	, ItemMargin(128.0f)
+	, ItemOrder(1)
+	, bItemsDirty(true)
+	, ItemVisit(0)
+	, ItemGridOrigin(FVector2D::ZeroVector)
+	, ItemGridSize(0, 0)
+	, ItemCellSize(MinItemCellSize)
+	, ItemQueryMin(FVector2D::ZeroVector)
+	, ItemQueryMax(FVector2D::ZeroVector)
+	, PendingPan(FVector2D::ZeroVector)
+	, PendingZoom(0.0f)
+	, bDirectManipulation(false)
+	, PanPredictionTime(0.0f)
+	, PanInertiaFriction(4.0f)
+	, PanVelocity(FVector2D::ZeroVector)
+	, DragStepDelta(FVector2D::ZeroVector)
+	, bLatencyInput(false)
+	, bLatencyApplied(false)
+	, LatencyInputFrame(0)
+	, LatencyInputTime(0.0)
+	, LatencyStart(FVector2D::ZeroVector)
+	, LatencyTarget(FVector2D::ZeroVector)
+	, InputLatencyFrames(0)
+	, InputLatencySeconds(0.0f)
+	, ZoomBandHysteresis(0.1f)
+	, ZoomBand(INDEX_NONE)
 {
 	ZoomDriver.Reset();
 	PanDriver.Reset();
@@ -27,22 +77,348 @@ void SPanZoomPanel::Construct(const SPanZoomPanel::FArguments& InArgs)
 {
 	MapStyle = InArgs._MapStyle;
 	MinimumDesiredSize = InArgs._MinimumDesiredSize;
+	OnPointerHovered = InArgs._OnPointerHovered;
+	OnPointerClicked = InArgs._OnPointerClicked;
+	OnPointerLeft = InArgs._OnPointerLeft;
+	OnGetItemCount = InArgs._OnGetItemCount;
+	OnGetItemPosition = InArgs._OnGetItemPosition;
+	OnGenerateItem = InArgs._OnGenerateItem;
+	OnReleaseItem = InArgs._OnReleaseItem;
+	ItemMargin = InArgs._ItemMargin;
+	ItemOrder = InArgs._ItemOrder;
+	ZoomBands = InArgs._ZoomBands;
+	ZoomBandHysteresis = InArgs._ZoomBandHysteresis;
+	bDirectManipulation = InArgs._DirectManipulation;
+	PanPredictionTime = InArgs._PanPredictionTime;
+	PanInertiaFriction = InArgs._PanInertiaFriction;
+	bItemsDirty = true;
 
 	ZoomDriver.Reset();
 	PanDriver.Reset();
+	ZoomBand = INDEX_NONE;
+	UpdateZoomBand(true);
 
 	const int32 NumSlots = InArgs.Slots.Num();
 	for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
 	{
+		AcquireSlotHandle(*InArgs.Slots[SlotIndex]);
 		Children.Add(InArgs.Slots[SlotIndex]);
 	}
 
-	Children.Sort(&FSlot::Sort);
+	bChildrenUnsorted = true;
+	SortChildren();
+}
+
+SPanZoomPanel::FSlot& SPanZoomPanel::AddSlot()
+{
+	FSlot& NewSlot = *new FSlot();
+	AcquireSlotHandle(NewSlot);
+	NewSlot.ChildIndex = Children.Add(&NewSlot);
+	bChildrenUnsorted = true;
+	return NewSlot;
+}
+
+SPanZoomPanel::FSlot& SPanZoomPanel::AddSlot(int32 InOrder)
+{
+	FSlot& NewSlot = *new FSlot();
+	NewSlot.RenderOrder = InOrder;
+	AcquireSlotHandle(NewSlot);
+	if (bChildrenUnsorted)
+	{
+		//The children get sorted anyway, so there is no order to insert into yet
+		NewSlot.ChildIndex = Children.Add(&NewSlot);
+		return NewSlot;
+	}
+
+	//Upper bound, so slots of the same order keep the order they were added in
+	int32 Low = 0;
+	int32 High = Children.Num();
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High) / 2;
+		if (Children[Middle].RenderOrder <= InOrder)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+	Children.Insert(&NewSlot, Low);
+	UpdateChildIndices(Low);
+	return NewSlot;
+}
+
+void SPanZoomPanel::BeginBatch()
+{
+	++BatchDepth;
+}
+
+void SPanZoomPanel::EndBatch()
+{
+	check(BatchDepth > 0);
+	if (--BatchDepth == 0)
+	{
+		SortChildren();
+	}
+}
+
+void SPanZoomPanel::SortChildren()
+{
+	if (bChildrenUnsorted && BatchDepth == 0)
+	{
+		Children.Sort(&FSlot::Sort);
+		UpdateChildIndices(0);
+		bChildrenUnsorted = false;
+		INC_DWORD_STAT(STAT_PanZoomSlotSorts);
+	}
+}
+
+void SPanZoomPanel::UpdateChildIndices(int32 StartIndex)
+{
+	for (int32 ChildIndex = StartIndex; ChildIndex < Children.Num(); ++ChildIndex)
+	{
+		Children[ChildIndex].ChildIndex = ChildIndex;
+	}
+}
+
+void SPanZoomPanel::AcquireSlotHandle(FSlot& Slot)
+{
+	FPanZoomSlotHandle& Handle = Slot.Handle;
+	if (FreeSlotHandles.Num() > 0)
+	{
+		Handle.Index = FreeSlotHandles.Pop(false);
+	}
+	else
+	{
+		Handle.Index = SlotHandles.Add({ nullptr, 0 });
+	}
+	Handle.Generation = SlotHandles[Handle.Index].Generation;
+	SlotHandles[Handle.Index].Slot = &Slot;
+}
+
+void SPanZoomPanel::RemoveChildAt(int32 ChildIndex)
+{
+	const int32 HandleIndex = Children[ChildIndex].Handle.Index;
+	if (HandleIndex != INDEX_NONE)
+	{
+		SlotHandles[HandleIndex].Slot = nullptr;
+		++SlotHandles[HandleIndex].Generation;
+		FreeSlotHandles.Add(HandleIndex);
+	}
+
+	//Removing keeps the rest in order, only the slots behind the hole move down
+	Children.RemoveAt(ChildIndex);
+	UpdateChildIndices(ChildIndex);
+}
+
+bool SPanZoomPanel::IsValid(const FPanZoomSlotHandle& Handle) const
+{
+	return SlotHandles.IsValidIndex(Handle.Index) && SlotHandles[Handle.Index].Generation == Handle.Generation && SlotHandles[Handle.Index].Slot != nullptr;
+}
+
+bool SPanZoomPanel::RemoveSlot(const FPanZoomSlotHandle& Handle)
+{
+	if (!IsValid(Handle))
+	{
+		return false;
+	}
+	RemoveChildAt(SlotHandles[Handle.Index].Slot->ChildIndex);
+	return true;
 }
 
 void SPanZoomPanel::ClearChildren()
 {
+	while (RealizedItems.Num() > 0)
+	{
+		ReleaseItem(RealizedItems.Num() - 1);
+	}
+	for (int32 HandleIndex = 0; HandleIndex < SlotHandles.Num(); ++HandleIndex)
+	{
+		if (SlotHandles[HandleIndex].Slot)
+		{
+			SlotHandles[HandleIndex].Slot = nullptr;
+			++SlotHandles[HandleIndex].Generation;
+			FreeSlotHandles.Add(HandleIndex);
+		}
+	}
 	Children.Empty();
+	bChildrenUnsorted = false;
+	bItemsDirty = true;
+}
+
+void SPanZoomPanel::RequestItemsRefresh()
+{
+	bItemsDirty = true;
+}
+
+TSharedPtr<SWidget> SPanZoomPanel::GetItemWidget(int32 ItemIndex) const
+{
+	const int32* RealizedIndex = RealizedIndices.Find(ItemIndex);
+	return RealizedIndex ? TSharedPtr<SWidget>(RealizedItems[*RealizedIndex].Slot->GetWidget()) : TSharedPtr<SWidget>();
+}
+
+void SPanZoomPanel::RebuildItemGrid()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PanZoomItemGridRebuild);
+
+	//Positions are read once per refresh, the per tick query only walks the cells around the view
+	const int32 NumItems = FMath::Max(OnGetItemCount.Execute(), 0);
+	FBox2D Bounds(ForceInit);
+	ItemPositions.SetNumUninitialized(NumItems);
+	for (int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex)
+	{
+		ItemPositions[ItemIndex] = OnGetItemPosition.Execute(ItemIndex);
+		Bounds += ItemPositions[ItemIndex];
+	}
+	ItemCellStarts.Reset();
+	ItemCellItems.Reset();
+	if (NumItems == 0)
+	{
+		ItemGridSize = FIntPoint(0, 0);
+		return;
+	}
+
+	//Cells hold a few items on average however spread out they are, and the grid never has many more cells than items
+	const FVector2D BoundsSize = Bounds.GetSize();
+	ItemCellSize = FMath::Max(MinItemCellSize, FMath::Sqrt(BoundsSize.X * BoundsSize.Y / NumItems) * 2.0f);
+	ItemGridOrigin = Bounds.Min;
+	ItemGridSize = FIntPoint(FMath::FloorToInt(BoundsSize.X / ItemCellSize) + 1, FMath::FloorToInt(BoundsSize.Y / ItemCellSize) + 1);
+	while ((int64)ItemGridSize.X * ItemGridSize.Y > 4 * (int64)NumItems + 16)
+	{
+		ItemCellSize *= 2.0f;
+		ItemGridSize = FIntPoint(FMath::FloorToInt(BoundsSize.X / ItemCellSize) + 1, FMath::FloorToInt(BoundsSize.Y / ItemCellSize) + 1);
+	}
+
+	//Counting sort of the items by cell, rare enough that the scratch is not kept
+	ItemCellStarts.SetNumZeroed(ItemGridSize.X * ItemGridSize.Y + 1);
+	TArray<int32> Cells;
+	Cells.SetNumUninitialized(NumItems);
+	for (int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex)
+	{
+		const FVector2D Offset = (ItemPositions[ItemIndex] - ItemGridOrigin) / ItemCellSize;
+		const int32 X = FMath::Clamp(FMath::FloorToInt(Offset.X), 0, ItemGridSize.X - 1);
+		const int32 Y = FMath::Clamp(FMath::FloorToInt(Offset.Y), 0, ItemGridSize.Y - 1);
+		Cells[ItemIndex] = Y * ItemGridSize.X + X;
+		++ItemCellStarts[Cells[ItemIndex] + 1];
+	}
+	for (int32 Cell = 1; Cell < ItemCellStarts.Num(); ++Cell)
+	{
+		ItemCellStarts[Cell] += ItemCellStarts[Cell - 1];
+	}
+	TArray<int32> Cursors = ItemCellStarts;
+	ItemCellItems.SetNumUninitialized(NumItems);
+	for (int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex)
+	{
+		ItemCellItems[Cursors[Cells[ItemIndex]]++] = ItemIndex;
+	}
+}
+
+void SPanZoomPanel::UpdateRealizedItems()
+{
+	if (!OnGetItemCount.IsBound() || !OnGetItemPosition.IsBound() || !OnGenerateItem.IsBound())
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_PanZoomItemUpdate);
+
+	const FSlateRect ViewRect = GetViewRect();
+	const FVector2D Min = FVector2D(ViewRect.Left, ViewRect.Top) - FVector2D(ItemMargin, ItemMargin);
+	const FVector2D Max = FVector2D(ViewRect.Right, ViewRect.Bottom) + FVector2D(ItemMargin, ItemMargin);
+	if (!bItemsDirty && Min == ItemQueryMin && Max == ItemQueryMax)
+	{
+		//A still view realizes the same items as last time
+		INC_DWORD_STAT_BY(STAT_PanZoomRealizedItems, RealizedItems.Num());
+		return;
+	}
+	ItemQueryMin = Min;
+	ItemQueryMax = Max;
+
+	if (bItemsDirty)
+	{
+		//Item indices may refer to other items now, so every widget goes back to the pool
+		while (RealizedItems.Num() > 0)
+		{
+			ReleaseItem(RealizedItems.Num() - 1);
+		}
+		RebuildItemGrid();
+		bItemsDirty = false;
+	}
+
+	++ItemVisit;
+	BeginBatch();
+	if (ItemPositions.Num() > 0)
+	{
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt((Min.X - ItemGridOrigin.X) / ItemCellSize), 0, ItemGridSize.X - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt((Min.Y - ItemGridOrigin.Y) / ItemCellSize), 0, ItemGridSize.Y - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt((Max.X - ItemGridOrigin.X) / ItemCellSize), 0, ItemGridSize.X - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt((Max.Y - ItemGridOrigin.Y) / ItemCellSize), 0, ItemGridSize.Y - 1);
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				const int32 Cell = Y * ItemGridSize.X + X;
+				for (int32 Entry = ItemCellStarts[Cell]; Entry < ItemCellStarts[Cell + 1]; ++Entry)
+				{
+					const int32 ItemIndex = ItemCellItems[Entry];
+					const FVector2D& Position = ItemPositions[ItemIndex];
+					if (Position.X < Min.X || Position.Y < Min.Y || Position.X > Max.X || Position.Y > Max.Y)
+					{
+						continue;
+					}
+
+					const int32* RealizedIndex = RealizedIndices.Find(ItemIndex);
+					if (RealizedIndex)
+					{
+						RealizedItems[*RealizedIndex].LastVisit = ItemVisit;
+						continue;
+					}
+
+					//Items coming into view take the widget of one that left if there is one
+					const TSharedPtr<SWidget> RecycledWidget = ItemWidgetPool.Num() > 0 ? TSharedPtr<SWidget>(ItemWidgetPool.Pop(false)) : TSharedPtr<SWidget>();
+					FSlot& NewSlot = *new FSlot();
+					NewSlot.Position(Position)
+						.HAlign(HAlign_Center)
+						.VAlign(VAlign_Center)
+						.Order(ItemOrder)
+						.ClampToBounds(false);
+					NewSlot.AttachWidget(OnGenerateItem.Execute(ItemIndex, RecycledWidget));
+					NewSlot.ChildIndex = Children.Add(&NewSlot);
+					bChildrenUnsorted = true;
+					RealizedIndices.Add(ItemIndex, RealizedItems.Add({ ItemIndex, &NewSlot, ItemVisit }));
+				}
+			}
+		}
+	}
+
+	//Anything not visited this tick has left the view
+	for (int32 RealizedIndex = RealizedItems.Num() - 1; RealizedIndex >= 0; --RealizedIndex)
+	{
+		if (RealizedItems[RealizedIndex].LastVisit != ItemVisit)
+		{
+			ReleaseItem(RealizedIndex);
+		}
+	}
+
+	EndBatch();
+	INC_DWORD_STAT_BY(STAT_PanZoomRealizedItems, RealizedItems.Num());
+}
+
+void SPanZoomPanel::ReleaseItem(int32 RealizedIndex)
+{
+	const FRealizedItem Item = RealizedItems[RealizedIndex];
+	const TSharedRef<SWidget> Widget = Item.Slot->GetWidget();
+	RemoveChildAt(Item.Slot->ChildIndex);
+	OnReleaseItem.ExecuteIfBound(Item.ItemIndex, Widget);
+	ItemWidgetPool.Add(Widget);
+
+	RealizedIndices.Remove(Item.ItemIndex);
+	RealizedItems.RemoveAtSwap(RealizedIndex, 1, false);
+	if (RealizedIndex < RealizedItems.Num())
+	{
+		RealizedIndices.Add(RealizedItems[RealizedIndex].ItemIndex, RealizedIndex);
+	}
 }
 
 int32 SPanZoomPanel::RemoveSlot(const TSharedRef<SWidget>& SlotWidget)
@@ -51,11 +427,10 @@ int32 SPanZoomPanel::RemoveSlot(const TSharedRef<SWidget>& SlotWidget)
 	{
 		if (SlotWidget == Children[SlotIdx].GetWidget())
 		{
-			Children.RemoveAt(SlotIdx);
+			RemoveChildAt(SlotIdx);
 			return SlotIdx;
 		}
 	}
-	Children.Sort(&FSlot::Sort);
 	return INDEX_NONE;
 }
 
@@ -112,6 +487,10 @@ int32 SPanZoomPanel::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGe
 {
 	LayerId = PaintBackgroundImage(Args, AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
 	LayerId = PaintChildren(Args, AllottedGeometry, MyClippingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
+	if (bLatencyApplied)
+	{
+		CheckInputLatency();
+	}
 	return LayerId;
 }
 
@@ -132,8 +511,14 @@ int32 SPanZoomPanel::PaintBackgroundImage(const FPaintArgs& Args, const FGeometr
 
 int32 SPanZoomPanel::PaintChildren(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
 {
-	FArrangedChildren ArrangedChildren(EVisibility::Visible);
+	FArrangedChildren& ArrangedChildren = PaintArrangedChildren;
+	const int32 ArrangedMax = ArrangedChildren.GetInternalArray().Max();
+	ArrangedChildren.GetInternalArray().Reset();
 	this->ArrangeChildren(AllottedGeometry, ArrangedChildren);
+	if (ArrangedChildren.GetInternalArray().Max() != ArrangedMax)
+	{
+		INC_DWORD_STAT(STAT_MapPaintScratchAllocations);
+	}
 
 	int32 MaxLayerId = LayerId;
 	const FPaintArgs NewArgs = Args.WithNewParent(this);
@@ -152,6 +537,8 @@ int32 SPanZoomPanel::PaintChildren(const FPaintArgs& Args, const FGeometry& Allo
 		}
 	}
 
+	//Let go of the widgets, so a child removed before the next paint is not kept alive by the scratch
+	ArrangedChildren.GetInternalArray().Reset();
 	return MaxLayerId;
 }
 
@@ -180,8 +567,8 @@ FChildren* SPanZoomPanel::GetChildren()
 void SPanZoomPanel::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
 {
 	LastTickGeometry = AllottedGeometry;
-	ZoomDriver.UpdateZoom(InDeltaTime);
-	PanDriver.UpdatePan(InDeltaTime);
+	UpdateRealizedItems();
+	SortChildren();
 	SPanel::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
 }
 
@@ -262,7 +649,8 @@ bool SPanZoomPanel::IsClickAction_OnTouchGesture(const FGeometry& MyGeometry, co
 
 bool SPanZoomPanel::IsPanAction_OnTouchStarted(const FGeometry& MyGeometry, const FPointerEvent& TouchEvent) const
 {
-	return false;
+	//Without direct manipulation touch panning comes in as scroll gestures
+	return bDirectManipulation && TouchEvent.GetPointerIndex() == 0;
 }
 
 bool SPanZoomPanel::IsZoomAction_OnTouchStarted(const FGeometry& MyGeometry, const FPointerEvent& TouchEvent) const
@@ -292,7 +680,7 @@ bool SPanZoomPanel::IsClickAction_OnTouchEnded(const FGeometry& MyGeometry, cons
 
 bool SPanZoomPanel::IsPanAction_OnTouchMoved(const FGeometry& MyGeometry, const FPointerEvent& TouchEvent) const
 {
-	return false;
+	return bIsPanning && bDirectManipulation && TouchEvent.GetPointerIndex() == 0;
 }
 
 bool SPanZoomPanel::IsZoomAction_OnTouchMoved(const FGeometry& MyGeometry, const FPointerEvent& TouchEvent) const
@@ -407,6 +795,10 @@ bool SPanZoomPanel::IsClickAction_OnAnalogValueChanged(const FGeometry& MyGeomet
 
 void SPanZoomPanel::HandlePan(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent)
 {
+	if (MouseEvent.IsTouchEvent() || MouseEvent.IsMouseButtonDown(EKeys::RightMouseButton))
+	{
+		bIsDragging = true;
+	}
 	Pan(MouseEvent.GetCursorDelta());
 	Pan(MouseEvent.GetGestureDelta());
 }
@@ -426,7 +818,11 @@ void SPanZoomPanel::HandleZoom(const FGeometry& MyGeometry, const FPointerEvent&
 
 void SPanZoomPanel::HandleClick(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent)
 {
-	
+	//Moving with the button held comes through here too, only the press itself clicks
+	if (MouseEvent.GetEffectingButton() == EKeys::LeftMouseButton)
+	{
+		OnPointerClicked.ExecuteIfBound(MyGeometry.AbsoluteToLocal(MouseEvent.GetScreenSpacePosition()));
+	}
 }
 
 void SPanZoomPanel::HandlePan(const FGeometry& MyGeometry, const FKeyEvent& KeyEvent)
@@ -463,7 +859,8 @@ void SPanZoomPanel::HandleZoom(const FGeometry& MyGeometry, const FKeyEvent& Key
 
 void SPanZoomPanel::HandleClick(const FGeometry& MyGeometry, const FKeyEvent& KeyEvent)
 {
-	
+	//Keys have no cursor, they click whatever is under the center of the view
+	OnPointerClicked.ExecuteIfBound(MyGeometry.GetLocalSize() * 0.5f);
 }
 
 void SPanZoomPanel::HandlePan(const FGeometry& MyGeometry, const FAnalogInputEvent& InAnalogInputEvent)
@@ -496,6 +893,11 @@ void SPanZoomPanel::HandleClick(const FGeometry& MyGeometry, const FAnalogInputE
 	
 }
 
+void SPanZoomPanel::HandleHover(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent)
+{
+	OnPointerHovered.ExecuteIfBound(MyGeometry.AbsoluteToLocal(MouseEvent.GetScreenSpacePosition()));
+}
+
 FReply SPanZoomPanel::OnMouseButtonDown(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) 
 {
 	if (IsPanAction_OnMouseButtonDown(MyGeometry, MouseEvent))
@@ -527,6 +929,7 @@ FReply SPanZoomPanel::OnMouseButtonUp(const FGeometry& MyGeometry, const FPointe
 	if (IsPanAction_OnMouseButtonUp(MyGeometry, MouseEvent))
 	{
 		bIsPanning = false;
+		EndDrag();
 		return FReply::Handled().ReleaseMouseCapture();
 	}
 
@@ -565,9 +968,24 @@ FReply SPanZoomPanel::OnMouseMove(const FGeometry& MyGeometry, const FPointerEve
 		return FReply::Handled();
 	}
 
+	HandleHover(MyGeometry, MouseEvent);
 	return FReply::Unhandled();
 }
 
+void SPanZoomPanel::OnMouseCaptureLost()
+{
+	//Capture taken away mid drag never sees the button come up
+	bIsPanning = false;
+	EndDrag();
+	SPanel::OnMouseCaptureLost();
+}
+
+void SPanZoomPanel::OnMouseLeave(const FPointerEvent& MouseEvent)
+{
+	OnPointerLeft.ExecuteIfBound();
+	SPanel::OnMouseLeave(MouseEvent);
+}
+
 FReply SPanZoomPanel::OnMouseWheel(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) 
 {
 	if (IsPanAction_OnMouseWheel(MyGeometry, MouseEvent))
@@ -626,7 +1044,7 @@ FReply SPanZoomPanel::OnTouchStarted(const FGeometry& MyGeometry, const FPointer
 	{
 		bIsPanning = true;
 		HandlePan(MyGeometry, InTouchEvent);
-		return FReply::Handled();
+		return FReply::Handled().CaptureMouse(SharedThis(this));
 	}
 
 	if (IsZoomAction_OnTouchStarted(MyGeometry, InTouchEvent))
@@ -651,7 +1069,8 @@ FReply SPanZoomPanel::OnTouchEnded(const FGeometry& MyGeometry, const FPointerEv
 	if (IsPanAction_OnTouchEnded(MyGeometry, InTouchEvent))
 	{
 		bIsPanning = false;
-		return FReply::Handled();
+		EndDrag();
+		return FReply::Handled().ReleaseMouseCapture();
 	}
 
 	if (IsZoomAction_OnTouchEnded(MyGeometry, InTouchEvent))
@@ -810,25 +1229,189 @@ FVector2D SPanZoomPanel::ToViewPosition(const FVector2D& WidgetPosition) const
 	return WidgetPosition / GetZoom() + GetViewOffset();
 }
 
+FVector2D SPanZoomPanel::ToScreenPosition(const FVector2D& WidgetPosition) const
+{
+	return LastTickGeometry.LocalToAbsolute(WidgetPosition);
+}
+
 float SPanZoomPanel::AngleToViewCenter(const FVector2D& Position, bool bIsInViewSpace) const
 {
 	return FMath::Acos(GetViewCenter() | (bIsInViewSpace ? Position : ToViewPosition(Position)));
 }
 
+bool SPanZoomPanel::IsViewAnimating() const
+{
+	return ViewTimerHandle.IsValid();
+}
+
+void SPanZoomPanel::StartViewAnimation()
+{
+	if (!ViewTimerHandle.IsValid())
+	{
+		ViewTimerHandle = RegisterActiveTimer(0.0f, FWidgetActiveTimerDelegate::CreateSP(this, &SPanZoomPanel::AnimateView));
+	}
+}
+
+EActiveTimerReturnType SPanZoomPanel::AnimateView(double InCurrentTime, float InDeltaTime)
+{
+	INC_DWORD_STAT(STAT_PanZoomAnimatingViews);
+	ApplyPendingInput();
+	ZoomDriver.UpdateZoom(InDeltaTime);
+	if (bDirectManipulation && (bIsDragging || !PanVelocity.IsZero()))
+	{
+		StepDirectPan(InDeltaTime);
+	}
+	else
+	{
+		PanDriver.UpdatePan(InDeltaTime);
+	}
+	UpdateZoomBand(false);
+
+	//Once both drivers reach their targets the timer goes away and Slate may sleep until the next input
+	return ZoomDriver.IsSettled() && PanDriver.IsSettled() && PanVelocity.IsZero() ? EActiveTimerReturnType::Stop : EActiveTimerReturnType::Continue;
+}
+
+void SPanZoomPanel::StepDirectPan(float DeltaTime)
+{
+	if (bIsDragging)
+	{
+		//Smoothed over a couple of steps, a held pointer lets it decay so a release after holding still does not throw
+		if (DeltaTime > 0.0f)
+		{
+			PanVelocity = FMath::Lerp(PanVelocity, DragStepDelta / DeltaTime, 0.5f);
+		}
+		DragStepDelta = FVector2D::ZeroVector;
+		if (PanVelocity.SizeSquared() < FMath::Square(MinPanVelocity))
+		{
+			PanVelocity = FVector2D::ZeroVector;
+		}
+		PanDriver.CurrentViewOffset = PanDriver.TargetViewOffset + PanVelocity * PanPredictionTime;
+		return;
+	}
+
+	PanDriver.TargetViewOffset += PanVelocity * DeltaTime;
+	PanDriver.CurrentViewOffset = PanDriver.TargetViewOffset;
+	PanVelocity *= FMath::Exp(-PanInertiaFriction * DeltaTime);
+	if (PanVelocity.SizeSquared() < FMath::Square(MinPanVelocity))
+	{
+		PanVelocity = FVector2D::ZeroVector;
+	}
+}
+
+void SPanZoomPanel::EndDrag()
+{
+	if (!bIsDragging)
+	{
+		return;
+	}
+	bIsDragging = false;
+	DragStepDelta = FVector2D::ZeroVector;
+	if (bDirectManipulation)
+	{
+		//Keep the predicted offset that was shown rather than jump back to the pointer
+		PanDriver.TargetViewOffset = PanDriver.CurrentViewOffset;
+		StartViewAnimation();
+	}
+}
+
+void SPanZoomPanel::CheckInputLatency() const
+{
+	//Shown once the view has covered the move the input asked for, however it eases there
+	const FVector2D Asked = LatencyTarget - LatencyStart;
+	const FVector2D Moved = GetViewOffset() - LatencyStart;
+	if ((Moved | Asked) >= Asked.SizeSquared() - KINDA_SMALL_NUMBER)
+	{
+		bLatencyApplied = false;
+		InputLatencyFrames = (uint32)(GFrameCounter - LatencyInputFrame);
+		InputLatencySeconds = (float)(FPlatformTime::Seconds() - LatencyInputTime);
+		SET_DWORD_STAT(STAT_PanZoomInputLatencyFrames, InputLatencyFrames);
+		SET_FLOAT_STAT(STAT_PanZoomInputLatencyMs, InputLatencySeconds * 1000.0f);
+	}
+	else if (GFrameCounter - LatencyInputFrame > MaxLatencyFrames)
+	{
+		AbandonInputLatency();
+	}
+}
+
+void SPanZoomPanel::AbandonInputLatency() const
+{
+	//The next pan input starts a fresh measurement
+	bLatencyInput = false;
+	bLatencyApplied = false;
+}
+
+void SPanZoomPanel::SetDirectManipulation(bool bEnabled, float PredictionTime, float InertiaFriction)
+{
+	bDirectManipulation = bEnabled;
+	PanPredictionTime = PredictionTime;
+	PanInertiaFriction = InertiaFriction;
+	if (!bDirectManipulation)
+	{
+		PanVelocity = FVector2D::ZeroVector;
+	}
+}
+
+void SPanZoomPanel::ApplyPendingInput()
+{
+	//The zoom only changes in the animation step, so dividing the sum is the same as dividing every event
+	if (!PendingPan.IsZero())
+	{
+		const FVector2D ViewDelta = PendingPan / GetZoom();
+		if (bLatencyApplied && (ViewDelta | (LatencyTarget - LatencyStart)) < 0.0f)
+		{
+			//Turned back before the view got there, so it may never cover the measured move
+			AbandonInputLatency();
+		}
+		if (bLatencyInput)
+		{
+			bLatencyInput = false;
+			bLatencyApplied = true;
+			LatencyStart = PanDriver.CurrentViewOffset;
+			LatencyTarget = PanDriver.TargetViewOffset + ViewDelta;
+		}
+		PanDriver.TargetViewOffset += ViewDelta;
+		if (bIsDragging)
+		{
+			DragStepDelta += ViewDelta;
+		}
+		PendingPan = FVector2D::ZeroVector;
+		INC_DWORD_STAT(STAT_PanZoomInputApplies);
+	}
+	if (PendingZoom != 0.0f)
+	{
+		ZoomDriver.AddZoom(PendingZoom);
+		PendingZoom = 0.0f;
+		INC_DWORD_STAT(STAT_PanZoomInputApplies);
+	}
+}
+
 void SPanZoomPanel::Pan(const FVector2D& PanAmountAndDirection)
 {
-	PanDriver.TargetViewOffset += (PanAmountAndDirection / GetZoom());
+	INC_DWORD_STAT(STAT_PanZoomInputEvents);
+	if (!bLatencyInput && !bLatencyApplied && !PanAmountAndDirection.IsZero())
+	{
+		bLatencyInput = true;
+		LatencyInputFrame = GFrameCounter;
+		LatencyInputTime = FPlatformTime::Seconds();
+	}
+	PendingPan += PanAmountAndDirection;
+	StartViewAnimation();
 }
 
 void SPanZoomPanel::Zoom(float ZoomAmount)
 {
-	ZoomDriver.AddZoom(ZoomAmount);
+	INC_DWORD_STAT(STAT_PanZoomInputEvents);
+	PendingZoom += ZoomAmount;
+	StartViewAnimation();
 }
 
 void SPanZoomPanel::SnapToZoom(float ZoomValue)
 {
+	ApplyPendingInput();
 	ZoomDriver.SetZoom(ZoomValue);
 	ZoomDriver.UpdateZoom(5000.0f);
+	UpdateZoomBand(true);
+	StartViewAnimation();
 }
 
 void SPanZoomPanel::PanTo(const FVector2D& DesiredViewPosition)
@@ -836,7 +1419,10 @@ void SPanZoomPanel::PanTo(const FVector2D& DesiredViewPosition)
 	const FVector2D ViewHalfSize = 0.5f * LastTickGeometry.Size / GetZoom();
 	FVector2D CurrentPosition = GetViewOffset() + ViewHalfSize;
 
+	ApplyPendingInput();
+	AbandonInputLatency();
 	PanDriver.TargetViewOffset = DesiredViewPosition - ViewHalfSize;
+	StartViewAnimation();
 }
 
 void SPanZoomPanel::SnapToViewPosition(const FVector2D& ViewPosition)
@@ -872,4 +1458,73 @@ void SPanZoomPanel::SetZoomRanges(float Min, float Max, const TArray<float>& Ran
 	ZoomDriver.Min = Min;
 	ZoomDriver.Max = Max;
 	ZoomDriver.ZoomValues = Ranges;
+	StartViewAnimation();
+}
+
+void SPanZoomPanel::SetZoomBands(const TArray<FPanZoomBand>& Bands, float Hysteresis)
+{
+	ZoomBands = Bands;
+	ZoomBandHysteresis = Hysteresis;
+	const int32 OldBand = ZoomBand;
+	ZoomBand = INDEX_NONE;
+	UpdateZoomBand(true);
+	if (ZoomBand == OldBand && ZoomBand != INDEX_NONE)
+	{
+		//The index is the same but what it stands for may not be, so it is announced as the first band of the new set
+		ZoomBandChanged.Broadcast(ZoomBand, INDEX_NONE);
+	}
+	else if (ZoomBand == INDEX_NONE && OldBand != INDEX_NONE)
+	{
+		ZoomBandChanged.Broadcast(INDEX_NONE, OldBand);
+	}
+}
+
+FName SPanZoomPanel::GetZoomBandName() const
+{
+	return ZoomBands.IsValidIndex(ZoomBand) ? ZoomBands[ZoomBand].Name : NAME_None;
+}
+
+float SPanZoomPanel::GetZoomBandMinZoom(int32 Band) const
+{
+	return ZoomBands.IsValidIndex(Band) ? FMath::Clamp(ZoomBands[Band].MinZoom, ZoomDriver.Min, ZoomDriver.Max) : ZoomDriver.Min;
+}
+
+void SPanZoomPanel::UpdateZoomBand(bool bImmediate)
+{
+	if (ZoomBands.Num() == 0)
+	{
+		return;
+	}
+
+	const float Zoom = GetZoom();
+	const float Hysteresis = bImmediate ? 0.0f : ZoomBandHysteresis;
+	int32 NewBand = ZoomBand;
+	if (NewBand == INDEX_NONE)
+	{
+		NewBand = 0;
+		while (NewBand + 1 < ZoomBands.Num() && Zoom >= ZoomBands[NewBand + 1].MinZoom)
+		{
+			++NewBand;
+		}
+	}
+	else
+	{
+		//Only step out of a band once the zoom is clearly past its edge, a fast zoom may cross several bands in one step
+		while (NewBand + 1 < ZoomBands.Num() && Zoom >= ZoomBands[NewBand + 1].MinZoom + Hysteresis)
+		{
+			++NewBand;
+		}
+		while (NewBand > 0 && Zoom < ZoomBands[NewBand].MinZoom - Hysteresis)
+		{
+			--NewBand;
+		}
+	}
+
+	if (NewBand != ZoomBand)
+	{
+		const int32 OldBand = ZoomBand;
+		ZoomBand = NewBand;
+		INC_DWORD_STAT(STAT_PanZoomBandChanges);
+		ZoomBandChanged.Broadcast(NewBand, OldBand);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MappingTypes.h"
+
+/**
+Bit packed explored / unexplored grid. Each row is a run of 64 bit words so revealing a span sets whole words at a time,
+and the rectangles of cells changed since the last ClearDirty are tracked so only those parts of a mask texture are rewritten.
+**/
+class MAPPING_API FMapExplorationGrid
+{
+public:
+	FMapExplorationGrid();
+
+	/*Resize to Width x Height cells, all unexplored and all dirty*/
+	void Init(int32 InWidth, int32 InHeight);
+
+	/*Mark every cell within Radius cells of Center explored. Returns true if any cell was newly explored*/
+	bool Reveal(const FIntPoint& Center, int32 Radius);
+
+	FORCEINLINE bool IsExplored(int32 X, int32 Y) const
+	{
+		return (Words[Y * WordsPerRow + (X >> 6)] >> (X & 63)) & 1;
+	}
+
+	FORCEINLINE int32 GetWidth() const { return Width; }
+	FORCEINLINE int32 GetHeight() const { return Height; }
+	FORCEINLINE bool IsDirty() const { return DirtyRects.Num() > 0; }
+
+	/*Disjoint rectangles covering the cells changed since the last ClearDirty, Max is exclusive. Touching rectangles are merged,
+	so revealers far apart keep separate small rectangles rather than one spanning the grid*/
+	FORCEINLINE const TArray<FIntRect>& GetDirtyRects() const { return DirtyRects; }
+	void ClearDirty();
+
+	/*Most dirty rectangles kept apart, past this the two whose union wastes the least area are merged*/
+	static const int32 MaxDirtyRects = 8;
+
+	/*Write a rectangle as one byte per cell, 0 explored and 255 unexplored, BytesPerCell apart and rows Pitch bytes apart*/
+	void ExpandRect(const FIntRect& Rect, uint8* OutAlpha, int32 BytesPerCell, int32 Pitch) const;
+
+	/*Heap memory held by the grid*/
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Words.GetAllocatedSize(); }
+
+	/*Run length encoded by word, explored regions and untouched regions both collapse to a single run*/
+	friend MAPPING_API FArchive& operator<<(FArchive& Ar, FMapExplorationGrid& Grid);
+
+private:
+	bool SetSpan(int32 Y, int32 X0, int32 X1);
+	void MarkDirty(FIntRect Rect);
+
+	TArray<uint64> Words;
+	int32 Width;
+	int32 Height;
+	int32 WordsPerRow;
+	TArray<FIntRect> DirtyRects;
+};
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MappingTypes.h"
+#include "UObject/GCObject.h"
+
+/**
+Histogram of world positions binned in the texture space of a map capture, for analytics overlays such as deaths or traffic.
+Samples are binned into per task partial histograms that are merged afterwards, so large batches spread over the worker threads
+without atomics. Blurring and uploading to the overlay texture only happen when UpdateTexture is called.
+**/
+class MAPPING_API FMapHeatmap : public FGCObject
+{
+public:
+	FMapHeatmap();
+
+	/*Bin into Resolution cells over the texture of a projection snapshot, clearing any samples*/
+	void Bind(const FMapProjection& InProjection, const FVector2D& InTextureSize, const FIntPoint& InResolution);
+
+	/*Clear all samples, keeping the binding*/
+	void Reset();
+
+	/*Project and bin a batch of world positions. Positions outside the bound texture are dropped*/
+	void AddSamples(const FVector* WorldLocations, int32 Count);
+	FORCEINLINE void AddSamples(const TArray<FVector>& WorldLocations) { AddSamples(WorldLocations.GetData(), WorldLocations.Num()); }
+
+	/*Blur the counts with a separable gaussian of BlurRadius cells, normalize them and write the overlay texture*/
+	void UpdateTexture(float BlurRadius);
+
+	FORCEINLINE const FMapProjection& GetProjection() const { return Projection; }
+	FORCEINLINE const FVector2D& GetTextureSize() const { return TextureSize; }
+	FORCEINLINE const FIntPoint& GetResolution() const { return Resolution; }
+	FORCEINLINE const TArray<uint32>& GetCounts() const { return Counts; }
+	FORCEINLINE uint64 GetNumSamples() const { return NumSamples; }
+
+	/*Overlay texture written by UpdateTexture, null until the first call*/
+	FORCEINLINE UTexture2D* GetTexture() const { return Texture; }
+
+	/*Colors of the lowest and highest blurred density, alpha included*/
+	FLinearColor ColdColor;
+	FLinearColor HotColor;
+
+	/*Sample count at which binning is spread over worker threads*/
+	static const int32 ParallelThreshold = 4096;
+
+	/*FGCObject Interface*/
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	/*End FGCObject Interface*/
+
+private:
+	void Blur(float BlurRadius);
+
+	FMapProjection Projection;
+	FVector2D TextureSize;
+	FIntPoint Resolution;
+
+	TArray<uint32> Counts;
+	uint64 NumSamples;
+
+	/*Histograms of every binning task after the first, which bins straight into Counts. Kept between batches to avoid reallocating*/
+	TArray<TArray<uint32>> Partials;
+	/*First and last cell each task binned into during the current batch*/
+	TArray<FIntPoint> PartialCells;
+
+	//Blur scratch
+	TArray<float> Density;
+	TArray<float> BlurScratch;
+
+	UTexture2D* Texture;
+};
\ No newline at end of file
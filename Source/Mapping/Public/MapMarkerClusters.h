@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MapMarkerStore.h"
+
+/* Nearby markers drawn as one icon, all the clustered markers of one band cell*/
+struct MAPPING_API FMapMarkerCluster
+{
+	/*Centroid of the members in texture space*/
+	FVector2D Location;
+	/*Where the cluster was drawn when its band was entered, it eases to Location while the expansion plays*/
+	FVector2D From;
+	int32 Cell;
+	TArray<int32> Members;
+	/*A member moved, joined or left since the centroid was taken*/
+	bool bCentroidDirty;
+};
+
+/* Which markers of a FMapMarkerStore are clustered. Markers outside the categories or views, hidden ones, ones with any of the
+unclustered flags and ones whose tier is not in TierMask are drawn on their own*/
+struct MAPPING_API FMapClusterFilter
+{
+	uint32 CategoryMask;
+	uint32 ViewMask;
+	EMapMarkerFlags UnclusteredFlags;
+	/*Bit per EMapMarkerUpdateTier*/
+	uint32 TierMask;
+
+	FMapClusterFilter()
+		: CategoryMask(MAX_uint32)
+		, ViewMask(MAX_uint32)
+		, UnclusteredFlags(EMapMarkerFlags::None)
+		, TierMask(MAX_uint32)
+	{}
+
+	FORCEINLINE bool Matches(const FMapMarkerStore& Markers, int32 MarkerIndex) const
+	{
+		return (Markers.GetCategories()[MarkerIndex] & CategoryMask) != 0
+			&& (Markers.GetViews()[MarkerIndex] & ViewMask) != 0
+			&& Markers.HasFlag(MarkerIndex, EMapMarkerFlags::Visible)
+			&& !Markers.HasFlag(MarkerIndex, UnclusteredFlags)
+			&& (TierMask & (1u << (uint32)Markers.GetTiers()[MarkerIndex])) != 0;
+	}
+
+	bool operator==(const FMapClusterFilter& Other) const
+	{
+		return CategoryMask == Other.CategoryMask && ViewMask == Other.ViewMask && UnclusteredFlags == Other.UnclusteredFlags && TierMask == Other.TierMask;
+	}
+
+	bool operator!=(const FMapClusterFilter& Other) const
+	{
+		return !(*this == Other);
+	}
+};
+
+/**
+Groups the markers of a FMapMarkerStore into square cells a power of two multiple of the store's culling grid, so at low zoom the
+icons drawn are bounded by the cells on screen instead of by the marker count. A band is one cell size. Clusters are only rebuilt
+when the band or the filter changes or the store's change log no longer reaches back to the last update. Otherwise only the markers
+the log names are moved between cells, and only the clusters they touched take their centroid again.
+**/
+class MAPPING_API FMapMarkerClusters
+{
+public:
+	FMapMarkerClusters();
+
+	/*Smallest band whose cells span ScreenSize at Scale screen units per texel, INDEX_NONE when a grid cell already does and markers should not be clustered*/
+	static int32 ComputeBand(float ScreenSize, float Scale);
+
+	/*Texels per side of the cells of a band*/
+	FORCEINLINE static float GetCellSize(int32 Band) { return (float)(FMapMarkerStore::GridCellSize << Band); }
+
+	/*Cluster the markers passing Filter into cells of Band, INDEX_NONE to stop clustering. Returns true if clusters were rebuilt*/
+	bool Update(const FMapMarkerStore& Markers, const FMapClusterFilter& Filter, int32 NewBand, float Time);
+
+	void Reset();
+
+	FORCEINLINE int32 GetBand() const { return Band; }
+	FORCEINLINE bool IsClustering() const { return Band != INDEX_NONE; }
+	FORCEINLINE const TArray<FMapMarkerCluster>& GetClusters() const { return Clusters; }
+
+	/*Append every cluster that may be drawn in TextureRect. While clusters ease after a band change they are drawn away from their cells, so all are appended*/
+	void QueryRect(const FBox2D& TextureRect, float Time, TArray<int32>& OutClusters) const;
+
+	/*Whether clusters or markers are still easing after a band change*/
+	FORCEINLINE bool IsAnimating(float Time) const { return GetExpandAlpha(Time) < 1.0f; }
+
+	/*Location a cluster is drawn at Time*/
+	FVector2D GetDrawLocation(const FMapMarkerCluster& Cluster, float Time) const;
+
+	/*Location an unclustered marker is drawn at Time, moving out of its last cluster right after clustering stopped*/
+	FVector2D GetMarkerDrawLocation(int32 MarkerIndex, const FVector2D& Location, float Time) const;
+
+	/*Seconds clusters take to split or merge after a band change*/
+	float ExpandTime;
+
+private:
+	float GetExpandAlpha(float Time) const;
+	void Rebuild(const FMapMarkerStore& Markers, const FMapClusterFilter& NewFilter, int32 NewBand, float Time);
+	/*Replay the change log from FirstChange, false if it does not line up with the markers binned so far*/
+	bool ApplyChanges(const FMapMarkerStore& Markers, int32 FirstChange, float Time);
+	void CaptureDrawLocations(const FMapMarkerStore& Markers, bool bBandChanged, float Time);
+	int32 GetCell(const FVector2D& Location) const;
+	void AddMember(const FMapMarkerStore& Markers, int32 MarkerIndex, int32 Cell, float Time);
+	void RemoveMember(int32 MarkerIndex);
+	void MarkCentroidDirty(int32 ClusterIndex);
+
+	int32 Band;
+	FMapClusterFilter Filter;
+	/*Change revision of the store the clusters are current with*/
+	uint32 ChangeRevision;
+	float ExpandStartTime;
+
+	TArray<FMapMarkerCluster> Clusters;
+
+	/*Cluster of each band cell or INDEX_NONE, row major over CellCounts*/
+	TArray<int32> CellClusters;
+	FIntPoint CellCounts;
+
+	/*Band cell of each marker or INDEX_NONE when not clustered, and its slot in the members of that cell's cluster*/
+	TArray<int32> MarkerCells;
+	TArray<int32> MemberSlots;
+
+	/*Where each marker was drawn when the band last changed*/
+	TArray<FVector2D> MarkerFrom;
+
+	//Update scratch
+	TArray<int32> ChangedMarkers;
+	TArray<int32> DirtyCells;
+	TArray<FVector2D> DrawnScratch;
+};
\ No newline at end of file
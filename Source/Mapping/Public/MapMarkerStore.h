@@ -0,0 +1,290 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MappingTypes.h"
+#include "MapTrail.h"
+#include "SlateBrush.h"
+#include "Rendering/SlateRenderTransform.h"
+
+class USceneMapComponent;
+
+/* Per marker state bits packed in FMapMarkerStore*/
+enum class EMapMarkerFlags : uint8
+{
+	None = 0,
+	Visible = 1 << 0,
+	ClampToEdge = 1 << 1,
+	/*Drawn by an icon widget rather than the marker layer*/
+	Widget = 1 << 2,
+};
+ENUM_CLASS_FLAGS(EMapMarkerFlags)
+
+/* Everything a FMapMarkerStore needs from its owner to sample and project markers for one frame*/
+struct MAPPING_API FMapMarkerUpdateContext
+{
+	FMapProjection Projection;
+	FVector FocusLocation;
+	float EveryFrameUpdateDistance;
+	float NormalUpdateDistance;
+	int32 NormalUpdateInterval;
+	int32 SlowUpdateInterval;
+
+	/*World time of the update, used to timestamp samples of smoothed markers*/
+	float Time;
+	/*How far behind the newest sample smoothed markers are displayed*/
+	float InterpolationDelay;
+	/*How far past the newest sample smoothed markers may be extrapolated*/
+	float MaxExtrapolationTime;
+	/*Categories whose markers turn with their component, others are drawn unrotated*/
+	uint32 RotatingCategories;
+
+	FMapMarkerUpdateContext()
+		: FocusLocation(FVector::ZeroVector)
+		, EveryFrameUpdateDistance(2000.0f)
+		, NormalUpdateDistance(10000.0f)
+		, NormalUpdateInterval(4)
+		, SlowUpdateInterval(30)
+		, Time(0.0f)
+		, InterpolationDelay(0.1f)
+		, MaxExtrapolationTime(0.25f)
+		, RotatingCategories(MAX_uint32)
+	{}
+
+	/*Resolve the update tier of a component sampled at the given location*/
+	EMapMarkerUpdateTier ResolveTier(const USceneMapComponent* Component, const FVector& WorldLocation) const;
+};
+
+/* Short history of sampled locations of a smoothed marker. A sample is only pushed when the location changes, so at low net update rates the history holds replicated positions*/
+struct MAPPING_API FMapMarkerHistory
+{
+	static const int32 Capacity = 4;
+
+	FVector Locations[Capacity];
+	float Times[Capacity];
+	int32 Newest;
+	int32 Count;
+
+	FMapMarkerHistory()
+		: Newest(INDEX_NONE)
+		, Count(0)
+	{}
+
+	/*Record a sample if the location moved, or if it has been still long enough that extrapolation should stop*/
+	void Sample(float Time, const FVector& Location, float StillTime);
+
+	/*Interpolated location at RenderTime, extrapolated by at most MaxExtrapolationTime past the newest sample*/
+	FVector Evaluate(float RenderTime, float MaxExtrapolationTime) const;
+
+private:
+	FORCEINLINE int32 Older(int32 Index) const { return (Index + Capacity - 1) % Capacity; }
+};
+
+/* Entry of the change log of a FMapMarkerStore. MarkerIndex was added, or its cell, location, flags, tier or views may have changed.
+With MovedFrom set MarkerIndex was removed instead, and the marker at MovedFrom, the last one, took over its index*/
+struct MAPPING_API FMapMarkerChange
+{
+	int32 MarkerIndex;
+	int32 MovedFrom;
+};
+
+/* Key funcs for maps keyed by component that match on object index and serial number, so an entry is still found for a destroyed component
+rather than matching any other stale key*/
+template<typename ValueType>
+struct TMapComponentKeyFuncs : TDefaultMapKeyFuncs<TWeakObjectPtr<USceneMapComponent>, ValueType, false>
+{
+	typedef typename TDefaultMapKeyFuncs<TWeakObjectPtr<USceneMapComponent>, ValueType, false>::KeyInitType KeyInitType;
+
+	static FORCEINLINE bool Matches(KeyInitType A, KeyInitType B)
+	{
+		return A.HasSameIndexAndSerialNumber(B);
+	}
+};
+
+/**
+Structure of arrays store of every marker drawn from one map capture. The store is filled once per frame on the game thread
+and widgets only read the packed arrays, so painting never touches the SceneMapComponents. All arrays share the marker index,
+which is stable until a marker is removed.
+**/
+class MAPPING_API FMapMarkerStore
+{
+public:
+	FMapMarkerStore();
+
+	/*Add a reference to the marker of a component, sampling and projecting it immediately when new. ViewMask adds the marker to views. Returns the marker index*/
+	int32 Register(USceneMapComponent* Component, const FMapMarkerUpdateContext& Context, uint32 ViewMask = 0);
+
+	/*Release a reference made with Register, removing the marker from the views of ViewMask and from the store when none remain.
+	The component may already be destroyed or garbage collected*/
+	void Unregister(const TWeakObjectPtr<USceneMapComponent>& Component, uint32 ViewMask = 0);
+
+	/*Sample the markers that are due this frame and reproject if the projection moved*/
+	void Update(const FMapMarkerUpdateContext& Context);
+
+	/*Index of the marker of a component or INDEX_NONE*/
+	int32 Find(USceneMapComponent* Component) const;
+
+	FORCEINLINE int32 Num() const { return Components.Num(); }
+
+	FORCEINLINE const TArray<FVector2D>& GetMapLocations() const { return MapLocations; }
+	FORCEINLINE const TArray<float>& GetYaws() const { return Yaws; }
+	FORCEINLINE const TArray<uint8>& GetRotationSteps() const { return RotationSteps; }
+	FORCEINLINE const TArray<EMapMarkerFlags>& GetFlags() const { return Flags; }
+	FORCEINLINE const TArray<int32>& GetBrushIds() const { return BrushIds; }
+	FORCEINLINE const TArray<uint32>& GetCategories() const { return Categories; }
+	FORCEINLINE const TArray<uint32>& GetViews() const { return Views; }
+	FORCEINLINE const TArray<EMapMarkerUpdateTier>& GetTiers() const { return Tiers; }
+	FORCEINLINE const TArray<TWeakObjectPtr<USceneMapComponent>>& GetComponents() const { return Components; }
+
+	/*Brush markers of BrushId are painted with, the icon of the component unless replaced with SetDrawBrush*/
+	FORCEINLINE const FSlateBrush& GetBrush(int32 BrushId) const { return DrawBrushes[BrushId]; }
+	FORCEINLINE const FSlateBrush& GetSourceBrush(int32 BrushId) const { return Brushes[BrushId]; }
+	FORCEINLINE void SetDrawBrush(int32 BrushId, const FSlateBrush& Brush) { DrawBrushes[BrushId] = Brush; ++StaticRevision; }
+	FORCEINLINE int32 NumBrushes() const { return Brushes.Num(); }
+
+	FORCEINLINE bool HasFlag(int32 MarkerIndex, EMapMarkerFlags Flag) const { return EnumHasAnyFlags(Flags[MarkerIndex], Flag); }
+
+	/*Number of markers in a category, maintained on register and remove*/
+	FORCEINLINE int32 GetCategoryCount(EMapMarkerCategory Category) const { return CategoryCounts[(int32)Category]; }
+
+	/*Write 1 for every visible marker in any category of CategoryMask and any view of ViewMask and 0 otherwise. The loop is branch free over the packed arrays so it vectorizes*/
+	void FilterVisible(uint32 CategoryMask, uint32 ViewMask, TArray<uint8>& OutVisible) const;
+
+	/*Append every marker that may lie in TextureRect, plus every clamped marker since those show at the map edge wherever they are.
+	Markers outside the texture are binned into the border cells, so the caller still tests the exact locations*/
+	void QueryRect(const FBox2D& TextureRect, TArray<int32>& OutMarkers) const;
+
+	/*Texels per side of a culling grid cell*/
+	static const int32 GridCellSize = 64;
+
+	FORCEINLINE const FIntPoint& GetGridSize() const { return GridSize; }
+	FORCEINLINE const TArray<int32>& GetClampedMarkers() const { return ClampedMarkers; }
+
+	/*Bumped whenever a marker enters, leaves or changes grid cell, so consumers binning by cell know when to rebin*/
+	FORCEINLINE uint32 GetGridRevision() const { return GridRevision; }
+
+	/*Log of marker changes, so consumers that bin markers only revisit the ones that changed. It holds every change since the start of
+	the previous Update, and is cleared when the projection or grid moves every marker at once*/
+	FORCEINLINE const TArray<FMapMarkerChange>& GetChanges() const { return Changes; }
+
+	/*Revision of the newest change, a consumer that applied the log up to here is current*/
+	FORCEINLINE uint32 GetChangeRevision() const { return ChangeBase + Changes.Num(); }
+
+	/*Index into GetChanges of the first change after Revision, INDEX_NONE if the log no longer reaches back that far and the consumer has to start over*/
+	int32 FindChangesSince(uint32 Revision) const;
+
+	/*Bumped whenever a marker is added or removed or joins or leaves a view*/
+	FORCEINLINE uint32 GetMarkerRevision() const { return MarkerRevision; }
+
+	/*Bumped whenever anything drawn for Static tier markers may have changed: registrations, brushes, a static marker leaving or the projection moving*/
+	FORCEINLINE uint32 GetStaticRevision() const { return StaticRevision; }
+
+	/*Trails of the markers that record one, TrailMarker maps a trail back to its marker*/
+	FORCEINLINE int32 NumTrails() const { return Trails.Num(); }
+	FORCEINLINE const FMapTrail& GetTrail(int32 TrailSlot) const { return Trails[TrailSlot]; }
+	FORCEINLINE int32 GetTrailMarker(int32 TrailSlot) const { return TrailMarkers[TrailSlot]; }
+
+	/*Heap memory held by all trails*/
+	SIZE_T GetTrailAllocatedSize() const;
+
+	/*Icon rotation is quantized to this many steps per turn, so every icon transform comes from one shared table*/
+	static const int32 NumRotationSteps = 256;
+
+	static uint8 QuantizeYaw(float Yaw);
+	static float GetRotationAngle(uint8 RotationStep);
+	static const FSlateRenderTransform& GetRotationTransform(uint8 RotationStep);
+
+	/*Number of markers sampled by the last Update*/
+	FORCEINLINE int32 GetNumSampledLastUpdate() const { return NumSampledLastUpdate; }
+
+	/*Due marker count at which sampling and projection are spread over worker threads*/
+	static const int32 ParallelThreshold = 512;
+
+	/*Markers of any tier checked per Update for a destroyed component, Static markers are never sampled so only this finds them*/
+	static const int32 PurgeChecksPerUpdate = 64;
+
+private:
+	static const int32 NumTiers = (int32)EMapMarkerUpdateTier::EveryFrame + 1;
+	static const int32 NumCategoryBits = 32;
+
+	int32 FindOrAddBrush(const FSlateBrush& Brush);
+	void ProjectMarker(int32 MarkerIndex, const FMapProjection& Projection);
+	void AddToTier(int32 MarkerIndex, EMapMarkerUpdateTier Tier);
+	void RemoveFromTier(int32 MarkerIndex);
+	void RemoveAt(int32 MarkerIndex);
+	void CountCategories(uint32 CategoryMask, int32 Delta);
+	void RemoveHistory(int32 MarkerIndex);
+	void RemoveTrail(int32 MarkerIndex);
+	void ProjectAll(const FMapProjection& Projection);
+	void ResizeGrid(const FMapProjection& Projection);
+	void UpdateGridCell(int32 MarkerIndex);
+	void RemoveFromGrid(int32 MarkerIndex);
+	FORCEINLINE TArray<int32>& GetGridBucket(int32 Cell) { return Cell == ClampedCell ? ClampedMarkers : GridCells[Cell]; }
+	void LogChange(int32 MarkerIndex, int32 MovedFrom = INDEX_NONE);
+	void ResetChanges();
+
+	/*Grid cell of markers drawn clamped to the map edge, which are kept out of the grid*/
+	static const int32 ClampedCell = -2;
+
+	//Packed marker data
+	TArray<TWeakObjectPtr<USceneMapComponent>> Components;
+	TArray<FVector> WorldLocations;
+	TArray<FVector2D> MapLocations;
+	TArray<float> Yaws;
+	TArray<uint8> RotationSteps;
+	TArray<EMapMarkerFlags> Flags;
+	TArray<int32> BrushIds;
+	TArray<uint32> Categories;
+	/*Bit per widget showing the marker, so maps sharing a capture only draw their own markers*/
+	TArray<uint32> Views;
+	TArray<EMapMarkerUpdateTier> Tiers;
+	TArray<int32> TierSlots;
+	TArray<int32> RefCounts;
+	TArray<int32> HistorySlots;
+
+	/*Location histories of smoothed markers only, HistoryMarkers maps a history back to its marker*/
+	TArray<FMapMarkerHistory> Histories;
+	TArray<int32> HistoryMarkers;
+
+	TArray<int32> TrailSlots;
+	TArray<FMapTrail> Trails;
+	TArray<int32> TrailMarkers;
+
+	/*Marker indices bucketed by update tier, each frame only the due stride of a bucket is sampled*/
+	TArray<int32> TierMarkers[NumTiers];
+
+	/*Marker indices bucketed by texture space cell for culling, MarkerCells and GridSlots locate a marker in its bucket*/
+	TArray<TArray<int32>> GridCells;
+	TArray<int32> ClampedMarkers;
+	TArray<int32> MarkerCells;
+	TArray<int32> GridSlots;
+	FIntPoint GridSize;
+	uint32 GridRevision;
+
+	/*Change log, ChangeBase is the revision before its first entry. Entries older than the start of the previous Update are dropped*/
+	TArray<FMapMarkerChange> Changes;
+	uint32 ChangeBase;
+	uint32 LastUpdateChangeRevision;
+
+	/*Distinct icon brushes referenced by BrushIds, and what each is painted with*/
+	TArray<FSlateBrush> Brushes;
+	TArray<FSlateBrush> DrawBrushes;
+
+	TMap<TWeakObjectPtr<USceneMapComponent>, int32, FDefaultSetAllocator, TMapComponentKeyFuncs<int32>> Indices;
+
+	int32 CategoryCounts[NumCategoryBits];
+
+	//Per update scratch, kept to avoid reallocating every frame
+	TArray<int32> DueMarkers;
+	TArray<EMapMarkerUpdateTier> DueTiers;
+	TArray<bool> DueAlive;
+	TArray<int32> DeadMarkers;
+
+	uint32 StaticRevision;
+	uint32 MarkerRevision;
+
+	FMapProjection LastProjection;
+	uint32 FrameCounter;
+	int32 NumSampledLastUpdate;
+	int32 PurgeCursor;
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "MappingTypes.h"
+
+/**
+Breadcrumb trail of a map marker. World locations are kept in a fixed capacity ring buffer that is allocated once, and a new
+point is only taken once the marker has moved SampleDistance from the newest one. The projected points share the ring's slots,
+so taking a point never moves the others.
+**/
+class MAPPING_API FMapTrail
+{
+public:
+	/*Upper bound on points per trail, whatever the component asks for*/
+	static const int32 MaxCapacity = 1024;
+
+	FMapTrail(int32 InCapacity, float InSampleDistance, const FLinearColor& InColor);
+
+	/*Add the location if it is far enough from the newest point, projecting only the new point. Returns true if a point was added*/
+	bool Sample(const FVector& Location, const FMapProjection& Projection);
+
+	/*Reproject every point, used when the capture moves*/
+	void Project(const FMapProjection& Projection);
+
+	void Reset();
+
+	/*Projected point Index places after the oldest*/
+	FORCEINLINE const FVector2D& GetMapPoint(int32 Index) const
+	{
+		const int32 Slot = Oldest() + Index;
+		return MapPoints[Slot < Capacity ? Slot : Slot - Capacity];
+	}
+	FORCEINLINE int32 Num() const { return Count; }
+	FORCEINLINE int32 GetCapacity() const { return Capacity; }
+	FORCEINLINE const FLinearColor& GetColor() const { return Color; }
+
+	/*Heap memory held by this trail*/
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	FORCEINLINE int32 Newest() const { return (Head + Capacity - 1) % Capacity; }
+	FORCEINLINE int32 Oldest() const { return (Head + Capacity - Count) % Capacity; }
+
+	TArray<FVector> Points;
+	TArray<FVector2D> MapPoints;
+	int32 Capacity;
+	int32 Head;
+	int32 Count;
+	float SampleDistanceSquared;
+	FLinearColor Color;
+};
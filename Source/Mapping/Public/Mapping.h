@@ -5,6 +5,12 @@
 #include "ModuleManager.h"
 #include "Classes/MappingTypes.h"
 
+DECLARE_STATS_GROUP(TEXT("Mapping"), STATGROUP_Mapping, STATCAT_Advanced);
+
+/*Times the scratch storage map widgets keep across paints had to grow, zero once it reached the high water mark. Text is shaped ahead
+and trails are drawn as boxes, so nothing else allocates in map paint either, see the Mapping.Paint.SteadyStateAllocations test*/
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Map Paint Scratch Growth"), STAT_MapPaintScratchAllocations, STATGROUP_Mapping, MAPPING_API);
+
 class FMappingModule : public IModuleInterface
 {
 public:
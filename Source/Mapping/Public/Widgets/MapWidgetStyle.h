@@ -41,6 +41,58 @@ struct MAPPING_API FMapStyle : public FSlateWidgetStyle
 		ComponentBrush = NewComponentBrush;
 		return *this;
 	}
+
+	/*Icon of a cluster of markers, drawn with the member count over it*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateBrush ClusterBrush;
+	FMapStyle& SetClusterBrush(const FSlateBrush& NewClusterBrush)
+	{
+		ClusterBrush = NewClusterBrush;
+		return *this;
+	}
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateFontInfo ClusterFont;
+	FMapStyle& SetClusterFont(const FSlateFontInfo& NewClusterFont)
+	{
+		ClusterFont = NewClusterFont;
+		return *this;
+	}
+
+	/*Font of marker labels, drawn at the same screen size at every zoom*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateFontInfo LabelFont;
+	FMapStyle& SetLabelFont(const FSlateFontInfo& NewLabelFont)
+	{
+		LabelFont = NewLabelFont;
+		return *this;
+	}
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateColor LabelColor;
+	FMapStyle& SetLabelColor(const FSlateColor& NewLabelColor)
+	{
+		LabelColor = NewLabelColor;
+		return *this;
+	}
+
+	/*Drawn stretched along every segment of a marker trail and tinted to the trail color, the image height is the line width in screen units*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateBrush TrailBrush;
+	FMapStyle& SetTrailBrush(const FSlateBrush& NewTrailBrush)
+	{
+		TrailBrush = NewTrailBrush;
+		return *this;
+	}
+
+	/*Drawn over the whole minimap, transparent inside the circle the map shows through and opaque around it. A black circular mask by default*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FSlateBrush MinimapMaskBrush;
+	FMapStyle& SetMinimapMaskBrush(const FSlateBrush& NewMinimapMaskBrush)
+	{
+		MinimapMaskBrush = NewMinimapMaskBrush;
+		return *this;
+	}
 };
 
 /**
@@ -6,6 +6,8 @@
 #include "Widgets/SCompoundWidget.h"
 #include "SlateDelegates.h"
 #include "SceneCaptureComponentMap.h"
+#include "Widgets/MapWidgetStyle.h"
+#include "Widgets/SMapIconCanvas.h"
 
 
 class MAPPING_API SMap : public SCompoundWidget
@@ -13,8 +15,19 @@ class MAPPING_API SMap : public SCompoundWidget
 public:
 	SLATE_BEGIN_ARGS(SMap)
 		: _CaptureComponent(nullptr)
+		, _ActiveCategories(MAX_uint32)
+		, _MapStyle(&FMapStyle::GetDefault())
+		, _ClusterSize(64.0f)
+		, _MaxLabels(64)
+		, _ViewZoom(0.0f)
 	{}
 	SLATE_ARGUMENT(USceneCaptureComponentMap*, CaptureComponent)
+	SLATE_ARGUMENT(uint32, ActiveCategories)
+	SLATE_STYLE_ARGUMENT(FMapStyle, MapStyle)
+	SLATE_ARGUMENT(float, ClusterSize)
+	SLATE_ARGUMENT(int32, MaxLabels)
+	/*Zoom of the panel showing the map, see SMapLabelLayer*/
+	SLATE_ATTRIBUTE(float, ViewZoom)
 	SLATE_END_ARGS()
 
 		/** Constructs this widget with InArgs */
@@ -26,28 +39,90 @@ public:
 	void Add(USceneMapComponent* Component);
 	void Remove(USceneMapComponent* Component);
 	void RemoveAll();
+
+	/*Show exactly these components, adding and removing only the difference so unchanged icons keep their widgets*/
 	void SetAll(const TArray<USceneMapComponent*>& NewSceneComponents);
 
+	/*Draw the unexplored area of a volume over the map*/
+	void SetExplorationSource(class AMapSourceVolume* Volume);
+
+	/*Draw a heatmap of the capture component under the icons, NAME_None to hide it*/
+	void SetHeatmapOverlay(FName Heatmap);
+
+	/*Show only markers in any of the categories of the mask. Takes effect next frame without touching the icons*/
+	void SetActiveCategories(uint32 CategoryMask);
+	void SetCategoryActive(EMapMarkerCategory Category, bool bActive);
+	uint32 GetActiveCategories() const;
+
+	/*Screen size within which markers merge into a cluster when zoomed out, 0 to never cluster*/
+	void SetClusterSize(float NewClusterSize);
+
+	/*Switch clusters and labels per zoom band of the panel showing the map, see SMapMarkerLayer::SetZoomBand*/
+	void SetZoomBand(int32 Band, float MinZoomRatio);
+
+	/*Most marker labels shown at once, 0 to hide labels*/
+	void SetMaxLabels(int32 NewMaxLabels);
+
+	/*Place labels again, needed after changing the MapLabel of a shown component*/
+	void RefreshLabels();
+
+	/*Append the components whose marker is drawn under a screen space position, topmost first: icon widgets, then moving markers, then static ones*/
+	void PickMarkers(const FVector2D& ScreenPosition, TArray<USceneMapComponent*>& OutComponents) const;
+
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 	virtual FVector2D ComputeDesiredSize(float) const override;
 
 protected:
+	/*Create the icon widget of a component with bUseIconWidget set, other components are painted by the marker layer*/
 	virtual TSharedRef<SWidget> OnGenerateChildIcon(USceneMapComponent* Component, USceneCaptureComponentMap* CurrentMap) const;
 
 	//Helper Functions
 	FVector2D WorldLocationToMap(const FVector& WorldLocation) const;
 	TAttribute<FVector2D> CreateComponentToMapPositionAttribute(USceneMapComponent* Component) const;
-	EVisibility GetComponentVisibility(USceneMapComponent* Component) const;
+	EVisibility GetComponentVisibility(TWeakObjectPtr<USceneMapComponent> Component) const;
 
 private:
 	void RemoveAllWithSlack(int32 Slack);
+	void RemoveIconAt(int32 IconIndex);
+
+	/*Check up to Budget icons, continuing where the last sweep stopped, and remove those whose component was destroyed*/
+	void SweepStaleIcons(int32 Budget);
+
+	/*Have the static content panel record its draw elements again on the next paint*/
+	void InvalidateStaticContent();
+
+	struct FMapIcon
+	{
+		TWeakObjectPtr<USceneMapComponent> Component;
+		/*Icon widget on the icon canvas, unset for markers painted by the marker layer*/
+		FMapIconHandle Widget;
+	};
 
 	//Slate Objects
 	FSlateBrush MapBrush;
 	TSharedPtr<SImage> RenderImage;
 	TSharedPtr<SCanvas> Canvas;
-	SCanvas::FSlot* MapSlot;
+	TSharedPtr<class SInvalidationPanel> StaticPanel;
+	SCanvas::FSlot* StaticSlot;
+	TSharedPtr<class SMapMarkerLayer> StaticLayer;
+	TSharedPtr<class SMapMarkerLayer> MarkerLayer;
+	SCanvas::FSlot* MarkerLayerSlot;
+	TSharedPtr<class SMapLabelLayer> LabelLayer;
+	SCanvas::FSlot* LabelLayerSlot;
+	TSharedPtr<SMapIconCanvas> IconCanvas;
+	SCanvas::FSlot* IconCanvasSlot;
 
 	//World Objects
 	TWeakObjectPtr<USceneCaptureComponentMap> Map;
-	TMap<TWeakObjectPtr<USceneMapComponent>, TSharedRef<SWidget>> MapIcons;
+	/*Every added component, with its icon widget if it uses one. IconIndices finds a component's entry in Icons*/
+	TArray<FMapIcon> Icons;
+	TMap<TWeakObjectPtr<USceneMapComponent>, int32, FDefaultSetAllocator, TMapComponentKeyFuncs<int32>> IconIndices;
+	int32 SweepCursor;
+	FGeometry LastTickGeometry;
+	mutable TArray<int32> PickedMarkers;
+
+	//What the static content was last recorded for
+	FVector2D CachedPosition;
+	float CachedScale;
+	uint32 CachedStaticRevision;
 };
\ No newline at end of file
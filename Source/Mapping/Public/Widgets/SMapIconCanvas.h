@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "SPanel.h"
+
+/* Stable reference to an icon of a SMapIconCanvas. The generation tells a handle to a removed icon from one to an icon reusing its entry*/
+struct MAPPING_API FMapIconHandle
+{
+	int32 Index;
+	uint32 Generation;
+
+	FMapIconHandle()
+		: Index(INDEX_NONE)
+		, Generation(0)
+	{}
+
+	FORCEINLINE bool IsSet() const { return Index != INDEX_NONE; }
+};
+
+/**
+Canvas for map icon widgets, each centered on a position attribute. Unlike SCanvas, icons are added and removed in O(1) through
+handles: a dense handle table maps a handle to the icon's child slot and children are removed by swapping in the last one.
+Paint order between icons is therefore not stable, which icons never relied on.
+**/
+class MAPPING_API SMapIconCanvas : public SPanel
+{
+public:
+	class FSlot : public TSlotBase<FSlot>
+	{
+	public:
+		FSlot()
+			: TSlotBase<FSlot>()
+			, Position(FVector2D::ZeroVector)
+			, Size(FVector2D::ZeroVector)
+			, HandleIndex(INDEX_NONE)
+		{}
+
+		TAttribute<FVector2D> Position;
+		FVector2D Size;
+
+		/*Entry of the handle table pointing at this slot, fixed up when the slot moves*/
+		int32 HandleIndex;
+	};
+
+	SLATE_BEGIN_ARGS(SMapIconCanvas)
+	{
+		_Visibility = EVisibility::SelfHitTestInvisible;
+	}
+	SLATE_END_ARGS()
+
+	SMapIconCanvas();
+
+	void Construct(const FArguments& InArgs);
+
+	/*Add an icon centered on Position. The handle stays valid until the icon is removed*/
+	FMapIconHandle AddIcon(const TSharedRef<SWidget>& Widget, const TAttribute<FVector2D>& Position, const FVector2D& Size);
+
+	/*Remove an icon, returns false if the handle is stale*/
+	bool RemoveIcon(const FMapIconHandle& Handle);
+
+	bool IsValid(const FMapIconHandle& Handle) const;
+
+	/*Widget of an icon or null if the handle is stale*/
+	TSharedPtr<SWidget> GetIconWidget(const FMapIconHandle& Handle) const;
+
+	FORCEINLINE int32 NumIcons() const { return Children.Num(); }
+
+	void ClearIcons();
+
+	/**Beg Widget Interface**/
+	virtual void OnArrangeChildren(const FGeometry& AllottedGeometry, FArrangedChildren& ArrangedChildren) const override;
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float) const override;
+	virtual FChildren* GetChildren() override;
+	/**End Widget Interface**/
+
+private:
+	struct FHandleEntry
+	{
+		int32 SlotIndex;
+		uint32 Generation;
+	};
+
+	TPanelChildren<FSlot> Children;
+	/*Arranged icons of the last paint, reset rather than rebuilt so its storage is kept at the high water mark*/
+	mutable FArrangedChildren PaintArrangedChildren;
+	TArray<FHandleEntry> Handles;
+	TArray<int32> FreeHandles;
+};
\ No newline at end of file
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Widgets/SLeafWidget.h"
+#include "SceneCaptureComponentMap.h"
+#include "Widgets/MapWidgetStyle.h"
+
+class SMapMarkerLayer;
+
+/* Side of its icon a label is placed on, in the order they are tried*/
+enum class EMapLabelAnchor : uint8
+{
+	Right,
+	Left,
+	Above,
+	Below,
+	Num,
+};
+
+/* A label that found a free spot in the last layout*/
+struct MAPPING_API FMapLabelPlacement
+{
+	int32 MarkerIndex;
+	EMapLabelAnchor Anchor;
+	/*Size of the text in screen units*/
+	FVector2D Size;
+	FText Text;
+	/*Text shaped for the scale it is drawn at, painted without copying the string*/
+	FShapedGlyphSequencePtr ShapedText;
+};
+
+/**
+Leaf widget drawing the labels of markers next to their icons without overlap. Labels are placed greedily, highest priority first,
+into a screen space occupancy grid that every icon is stamped into beforehand. Placements are kept until the zoom band, the markers
+of the view or the filter change, or the view leaves the area laid out, and in between only the cached placements are painted,
+all as text shaped at layout on one layer so they batch.
+**/
+class MAPPING_API SMapLabelLayer : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SMapLabelLayer)
+		: _CaptureComponent(nullptr)
+		, _MapStyle(&FMapStyle::GetDefault())
+		, _MaxLabels(64)
+		, _ViewZoom(0.0f)
+	{}
+	SLATE_ARGUMENT(USceneCaptureComponentMap*, CaptureComponent)
+	SLATE_STYLE_ARGUMENT(FMapStyle, MapStyle)
+	/*Most labels shown at once, 0 shows none*/
+	SLATE_ARGUMENT(int32, MaxLabels)
+	/*Layer whose filter, view and clusters decide which markers are labelled*/
+	SLATE_ARGUMENT(TSharedPtr<SMapMarkerLayer>, MarkerLayer)
+	/*Zoom of the panel showing the map, so labels keep the DPI scale of the screen. At 0 labels are sized against the whole geometry scale*/
+	SLATE_ATTRIBUTE(float, ViewZoom)
+	SLATE_END_ARGS()
+
+	/** Constructs this widget with InArgs */
+	void Construct(const FArguments& InArgs);
+
+	void SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent);
+
+	void SetMaxLabels(int32 NewMaxLabels);
+	FORCEINLINE int32 GetMaxLabels() const { return MaxLabels; }
+
+	/*Lay labels out again on the next tick, for changes to label text the layer cannot see*/
+	void InvalidateLayout();
+
+	FORCEINLINE const TArray<FMapLabelPlacement>& GetPlacements() const { return Placements; }
+
+	/*Zoom band of a scale, used while the marker layer follows no band of the map panel. A layout is made for the smallest scale of
+	its band, so zooming in within the band only spreads labels apart*/
+	static int32 ComputeBand(float Scale);
+	static float GetBandScale(int32 Band);
+
+	/*Screen units per side of an occupancy grid cell*/
+	static const float OccupancyCellSize;
+
+	/**Beg Widget Interface**/
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float) const override;
+	/**End Widget Interface**/
+
+protected:
+	/*Place the labels of markers in TextureRect for LayoutScale screen units per texel*/
+	virtual void LayoutLabels(const FMapMarkerStore& Markers, const FBox2D& TextureRect, float LayoutScale);
+
+private:
+	/*Top left in layer space of a label of LabelSize screen units next to an icon of HalfIconSize texels drawn at Location*/
+	static FVector2D GetLabelOrigin(EMapLabelAnchor Anchor, const FVector2D& Location, const FVector2D& HalfIconSize, const FVector2D& LabelSize, float Scale);
+
+	/*Shape the text of every placement for drawing at DrawScale*/
+	void ShapeLabels(float DrawScale);
+
+	/*Label units per texel of the layer, the zoom of the view without the DPI scale labels are drawn at*/
+	float GetLabelScale(const FGeometry& AllottedGeometry) const;
+
+	/*Icon half size of a marker, icon widgets are drawn at their source brush size*/
+	FVector2D GetHalfIconSize(const FMapMarkerStore& Markers, int32 MarkerIndex) const;
+
+	/*Cells of the occupancy grid whose center lies in a screen space rect relative to the layout rect*/
+	void GetCellRange(const FVector2D& Min, const FVector2D& Max, FIntPoint& OutMin, FIntPoint& OutMax) const;
+	bool IsFree(const FVector2D& Min, const FVector2D& Max) const;
+	void Occupy(const FVector2D& Min, const FVector2D& Max);
+
+	TWeakObjectPtr<USceneCaptureComponentMap> Map;
+	const FMapStyle* MapStyle;
+	TWeakPtr<SMapMarkerLayer> MarkerLayer;
+	TAttribute<float> ViewZoom;
+	int32 MaxLabels;
+	bool bHidden;
+	TArray<FMapLabelPlacement> Placements;
+
+	//What the placements were laid out for
+	bool bLayoutDirty;
+	float LayoutScale;
+	uint32 LayoutMarkerRevision;
+	uint32 LayoutCategories;
+	FBox2D LayoutRect;
+	float ShapedScale;
+
+	struct FLabelCandidate
+	{
+		int32 MarkerIndex;
+		int32 Priority;
+		float DistanceSquared;
+	};
+
+	//Layout scratch
+	TArray<int32> QueryMarkers;
+	TArray<FLabelCandidate> Candidates;
+	TArray<uint8> Occupancy;
+	FIntPoint OccupancySize;
+};
\ No newline at end of file
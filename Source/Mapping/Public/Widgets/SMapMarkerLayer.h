@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Widgets/SLeafWidget.h"
+#include "SceneCaptureComponentMap.h"
+#include "MapMarkerClusters.h"
+#include "Widgets/MapWidgetStyle.h"
+
+class AMapSourceVolume;
+
+/* What a SMapMarkerLayer draws, so content that only changes with the view can be cached apart from moving markers*/
+enum class EMapMarkerLayerContent : uint8
+{
+	All,
+	/*Overlays and markers of the Static update tier*/
+	Static,
+	/*Trails and every marker not in the Static update tier*/
+	Dynamic,
+};
+
+/**
+Leaf widget covering the map texture that draws marker content straight from the capture's FMapMarkerStore. Icons are
+painted as boxes grouped by brush, so Slate batches them into a draw call per texture instead of a widget per marker.
+It also owns the category filter of its map, so every consumer of the filter reads one pass over the store per frame.
+When zoomed out so far that markers would crowd, they are drawn as clusters with a count instead.
+**/
+class MAPPING_API SMapMarkerLayer : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SMapMarkerLayer)
+		: _CaptureComponent(nullptr)
+		, _ActiveCategories(MAX_uint32)
+		, _MapStyle(&FMapStyle::GetDefault())
+		, _ClusterSize(64.0f)
+		, _Content(EMapMarkerLayerContent::All)
+		, _PaintWidgetMarkers(false)
+	{}
+	SLATE_ARGUMENT(USceneCaptureComponentMap*, CaptureComponent)
+	SLATE_ARGUMENT(uint32, ActiveCategories)
+	SLATE_STYLE_ARGUMENT(FMapStyle, MapStyle)
+	/*Screen size of a cluster cell, markers closer than about this on screen are merged. 0 disables clustering*/
+	SLATE_ARGUMENT(float, ClusterSize)
+	SLATE_ARGUMENT(EMapMarkerLayerContent, Content)
+	/*Draw the markers of this layer's view rather than acquiring a view, for several layers of one map*/
+	SLATE_ARGUMENT(TSharedPtr<SMapMarkerLayer>, ViewSource)
+	/*Paint markers of components that use an icon widget as boxes too, for maps that make no icon widgets*/
+	SLATE_ARGUMENT(bool, PaintWidgetMarkers)
+	SLATE_END_ARGS()
+
+	/** Constructs this widget with InArgs */
+	void Construct(const FArguments& InArgs);
+
+	virtual ~SMapMarkerLayer();
+
+	/*Switch capture, moving the view of this layer to the new capture*/
+	void SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent);
+
+	/*View bit of this layer on its capture, pass it when registering markers this layer should draw*/
+	FORCEINLINE uint32 GetViewMask() const { return ViewMask; }
+
+	/*Draw the unexplored area of a volume over the map, nullptr to stop*/
+	void SetExplorationSource(AMapSourceVolume* Volume);
+
+	/*Draw a heatmap of the capture under the markers, NAME_None to stop*/
+	void SetHeatmapOverlay(FName Heatmap);
+
+	void SetActiveCategories(uint32 CategoryMask);
+	FORCEINLINE uint32 GetActiveCategories() const { return ActiveCategories; }
+
+	void SetClusterSize(float NewClusterSize);
+	FORCEINLINE float GetClusterSize() const { return ClusterSize; }
+	FORCEINLINE const FMapMarkerClusters& GetClusters() const { return Clusters; }
+
+	/*Follow a zoom band of the panel showing the map, so clusters and the labels over this layer only change when the band does.
+	MinZoomRatio is the smallest zoom of the band over the current zoom. INDEX_NONE goes back to following the scale*/
+	void SetZoomBand(int32 Band, float MinZoomRatio);
+	FORCEINLINE int32 GetZoomBand() const { return ZoomBand; }
+
+	/*Scale at the smallest zoom of the followed band, content is laid out for it. 0 when not following a band*/
+	FORCEINLINE float GetZoomBandScale() const { return ZoomBandScale; }
+
+	/*Whether the marker passed this frame's visibility and category filter*/
+	FORCEINLINE bool IsMarkerVisible(int32 MarkerIndex) const { return VisibleMarkers.IsValidIndex(MarkerIndex) && VisibleMarkers[MarkerIndex] != 0; }
+
+	/*Texture space rect this layer was clipped to when last painted, grown by CullMargin. Markers outside it are not painted*/
+	FORCEINLINE const FBox2D& GetVisibleTextureRect() const { return VisibleTextureRect; }
+
+	/*Whether a marker is inside the visible rect of the last paint or shows at the map edge regardless*/
+	bool IsMarkerInView(int32 MarkerIndex) const;
+
+	/*Append the markers whose icon covers a position in layer space, topmost first. Icon widgets are above everything the layer paints, a cluster
+	is above markers and appends all its members, and between painted markers the one painted later wins. Only what was on screen at the last paint is picked*/
+	void PickMarkers(const FVector2D& LocalPosition, TArray<int32>& OutMarkers) const;
+
+	/*Whether anything this layer draws changed in a way the marker store does not report, such as a new overlay texture or a cluster animation*/
+	bool NeedsRepaint() const;
+
+	/*Filter the store and update clusters for the frame at CurrentTime, done on tick once a frame. A layer under a cached panel is not ticked
+	while the cache holds, so its owner calls this every frame to keep picking current*/
+	void UpdateMarkers(const FGeometry& AllottedGeometry, double CurrentTime);
+
+	/*Texels around the clipped view in which markers are still painted, so icons straddling the edge and markers moving in do not pop*/
+	static const float CullMargin;
+
+	/**Beg Widget Interface**/
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float) const override;
+	/**End Widget Interface**/
+
+protected:
+	/*Draw the overlay heatmap, moved onto the current projection if the capture moved since the heatmap was bound*/
+	virtual int32 PaintHeatmap(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const;
+
+	/*Draw the exploration mask stretched over the projected grid of the exploration source*/
+	virtual int32 PaintFog(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const;
+
+	/*Draw the icons of visible markers that do not use icon widgets, one run of boxes per brush*/
+	virtual int32 PaintMarkers(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const;
+
+	/*Draw the clusters on screen as the cluster brush of the style with the member count over it*/
+	virtual int32 PaintClusters(const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const;
+
+	/*Draw every visible trail as a strip of trail brush segments*/
+	virtual int32 PaintTrails(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle) const;
+
+private:
+	/*Whether the marker belongs to the content of this layer*/
+	FORCEINLINE bool DrawsMarker(const FMapMarkerStore& Markers, int32 MarkerIndex) const
+	{
+		return Content == EMapMarkerLayerContent::All || (Markers.GetTiers()[MarkerIndex] == EMapMarkerUpdateTier::Static) == (Content == EMapMarkerLayerContent::Static);
+	}
+
+	/*Whether the marker is drawn by an icon widget over this layer instead of by the layer*/
+	FORCEINLINE bool IsPaintedByWidget(const FMapMarkerStore& Markers, int32 MarkerIndex) const
+	{
+		return !bPaintWidgetMarkers && Markers.HasFlag(MarkerIndex, EMapMarkerFlags::Widget);
+	}
+
+	void UpdateClusters(const FMapMarkerStore& Markers, float Scale);
+
+	/*Distance from its center within which an icon of Brush is hit*/
+	FORCEINLINE static float GetPickRadius(const FSlateBrush& Brush) { return FMath::Max(Brush.ImageSize.X, Brush.ImageSize.Y) * 0.5f; }
+
+	/*Cull markers and clusters to the clip rect and bucket the markers left by brush*/
+	void GatherDrawList(const FMapMarkerStore& Markers, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect) const;
+
+	TWeakObjectPtr<USceneCaptureComponentMap> Map;
+	const FMapStyle* MapStyle;
+	EMapMarkerLayerContent Content;
+	TWeakPtr<SMapMarkerLayer> ViewSource;
+	bool bOwnsView;
+	bool bPaintWidgetMarkers;
+	TWeakObjectPtr<AMapSourceVolume> ExplorationSource;
+	FSlateBrush FogBrush;
+	FName HeatmapOverlay;
+	FSlateBrush HeatmapBrush;
+	uint32 ActiveCategories;
+	uint32 ViewMask;
+	TArray<uint8> VisibleMarkers;
+	mutable FBox2D VisibleTextureRect;
+	mutable FVector2D PaintedSize;
+
+	float ClusterSize;
+	float ClusterTime;
+	double MarkersUpdateTime;
+	int32 ZoomBand;
+	float ZoomBandRatio;
+	float ZoomBandScale;
+	FMapMarkerClusters Clusters;
+
+	//Paint scratch. Markers to paint and where, bucketed by brush: BrushStarts[BrushId] to BrushStarts[BrushId + 1] index into DrawOrder
+	mutable TArray<int32> CandidateMarkers;
+	mutable TArray<FVector2D> CandidateLocations;
+	mutable TArray<int32> VisibleClusters;
+	mutable TArray<int32> DrawOrder;
+	mutable TArray<int32> BrushStarts;
+	/*Member count texts of the counts drawn so far, shaped the first time a count is drawn at ClusterCountScale instead of every paint*/
+	mutable TMap<int32, FShapedGlyphSequencePtr> ClusterCountTexts;
+	mutable float ClusterCountScale;
+
+	//Pick scratch
+	mutable TArray<int32> PickCandidates;
+	mutable TArray<int32> PickClusters;
+	mutable TArray<int32> PickHits;
+};
@@ -9,6 +9,9 @@
 #include "SPanZoomPanel.h"
 #include "SMap.h"
 
+/*Components of the markers under a position, topmost first. Empty when there are none*/
+DECLARE_DELEGATE_OneParam(FOnMapMarkersPicked, const TArray<USceneMapComponent*>& /*Components*/);
+
 /**
  * 
  */
@@ -37,6 +40,10 @@ public:
 		SLATE_ATTRIBUTE(EVisibility, FooterVisibility)
 		SLATE_ATTRIBUTE(EVisibility, LeftSidebarVisibility)
 		SLATE_ATTRIBUTE(EVisibility, RightSidebarVisibility)
+		/*The markers under the cursor changed*/
+		SLATE_EVENT(FOnMapMarkersPicked, OnMarkersHovered)
+		/*The map was clicked, with the markers under the click*/
+		SLATE_EVENT(FOnMapMarkersPicked, OnMarkersSelected)
 	SLATE_END_ARGS()
 
 	/** Constructs this widget with InArgs */
@@ -54,8 +61,17 @@ public:
 	void SetZoomSpeed(float NewSpeed);
 	void SetPanSpeed(float NewSpeed);
 	void SetZoomRanges(float Min, float Max, const TArray<float>& Ranges);
+	void SetZoomBands(const TArray<FPanZoomBand>& Bands, float Hysteresis);
+	void SetDirectManipulation(bool bEnabled, float PredictionTime, float InertiaFriction);
+	int32 GetZoomBand() const;
+	FName GetZoomBandName() const;
+	FOnPanZoomBandChanged& OnZoomBandChanged();
 	SPanZoomPanel::FSlot& AddSlot();
+	SPanZoomPanel::FSlot& AddSlot(int32 Order);
+	void BeginBatch();
+	void EndBatch();
 	void RemoveSlot(TSharedRef<SWidget> Widget);
+	bool RemoveSlot(const FPanZoomSlotHandle& Handle);
 	/**End SpanZoom Wrapper**/
 
 	/**Beg SMap Wrapper**/
@@ -64,8 +80,19 @@ public:
 	void Remove(class USceneMapComponent* Component);
 	void RemoveAll();
 	void SetAll(const TArray<USceneMapComponent*>& NewSceneComponents);
+	void SetExplorationSource(class AMapSourceVolume* Volume);
+	void SetHeatmapOverlay(FName Heatmap);
+	void SetActiveCategories(uint32 CategoryMask);
+	void SetCategoryActive(EMapMarkerCategory Category, bool bActive);
+	uint32 GetActiveCategories() const;
+	void SetClusterSize(float NewClusterSize);
+	void SetMaxLabels(int32 NewMaxLabels);
+	void RefreshLabels();
 	/**End SMap Wrapper**/
 
+	/*Append the components whose marker is drawn under a position in map panel space, topmost first*/
+	void PickMarkers(const FVector2D& PanelPosition, TArray<USceneMapComponent*>& OutComponents) const;
+
 	void SetHeaderVisibility(TAttribute<EVisibility> NewVisibility);
 	void SetFooterVisibility(TAttribute<EVisibility> NewVisibility);
 	void SetLeftSidebarVisibility(TAttribute<EVisibility> NewVisibility);
@@ -78,4 +105,18 @@ protected:
 	TAttribute<EVisibility> FooterVisibility;
 	TAttribute<EVisibility> LeftSidebarVisibility;
 	TAttribute<EVisibility> RightSidebarVisibility;
+
+	FOnMapMarkersPicked OnMarkersHovered;
+	FOnMapMarkersPicked OnMarkersSelected;
+
+private:
+	void HandlePanelHovered(const FVector2D& PanelPosition);
+	void HandlePanelClicked(const FVector2D& PanelPosition);
+	void HandlePanelLeft();
+	void HandleZoomBandChanged(int32 NewBand, int32 OldBand);
+	void SetHoveredMarkers(const TArray<USceneMapComponent*>& Components);
+
+	/*What OnMarkersHovered last reported, so hover only fires when it changes*/
+	TArray<TWeakObjectPtr<USceneMapComponent>> HoveredMarkers;
+	TArray<USceneMapComponent*> PickedMarkers;
 };
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Widgets/SCompoundWidget.h"
+#include "SceneCaptureComponentMap.h"
+#include "Widgets/MapWidgetStyle.h"
+
+class SMapMarkerLayer;
+
+/**
+Compact map for the HUD at a fixed zoom, optionally centered on a followed component. It reads the marker store of its capture like a
+full map does, so markers shown on both are sampled and projected once per frame, and it makes no icon widgets: every marker is
+painted by one marker layer culled to the minimap. The style's minimap mask is drawn over everything, opaque outside the circle.
+A follow target that was not added on its own is removed again once the minimap stops following it.
+**/
+class MAPPING_API SMiniMap : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SMiniMap)
+		: _CaptureComponent(nullptr)
+		, _MapStyle(&FMapStyle::GetDefault())
+		, _Size(FVector2D(256.0f, 256.0f))
+		, _Zoom(0.5f)
+		, _ActiveCategories(MAX_uint32)
+		, _ClusterSize(32.0f)
+		, _FollowTarget(nullptr)
+	{}
+	SLATE_ARGUMENT(USceneCaptureComponentMap*, CaptureComponent)
+	SLATE_STYLE_ARGUMENT(FMapStyle, MapStyle)
+	SLATE_ARGUMENT(FVector2D, Size)
+	/*Screen units per texel of the map texture*/
+	SLATE_ARGUMENT(float, Zoom)
+	SLATE_ARGUMENT(uint32, ActiveCategories)
+	SLATE_ARGUMENT(float, ClusterSize)
+	/*Component the minimap stays centered on, shown as a marker as well*/
+	SLATE_ARGUMENT(USceneMapComponent*, FollowTarget)
+	SLATE_END_ARGS()
+
+	/** Constructs this widget with InArgs */
+	void Construct(const FArguments& InArgs);
+
+	virtual ~SMiniMap();
+
+	void SetCaptureComponent(USceneCaptureComponentMap* NewMapCaptureComponent);
+	void Add(USceneMapComponent* Component);
+	void Remove(USceneMapComponent* Component);
+	void RemoveAll();
+
+	/*Center on a component every frame, nullptr to stay where the view is*/
+	void SetFollowTarget(USceneMapComponent* Component);
+	FORCEINLINE USceneMapComponent* GetFollowTarget() const { return FollowTarget.Get(); }
+
+	/*Center on a texture space position, stops following*/
+	void SetViewCenter(const FVector2D& TexturePosition);
+	FORCEINLINE const FVector2D& GetViewCenter() const { return ViewCenter; }
+
+	void SetZoom(float NewZoom);
+	FORCEINLINE float GetZoom() const { return Zoom; }
+
+	void SetActiveCategories(uint32 CategoryMask);
+
+	/**Beg Widget Interface**/
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+	virtual void OnArrangeChildren(const FGeometry& AllottedGeometry, FArrangedChildren& ArrangedChildren) const override;
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyClippingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float) const override;
+	/**End Widget Interface**/
+
+private:
+	/*Geometry of the map texture in the minimap, scaled by the zoom and placed so the view center is in the middle*/
+	FGeometry MakeMapGeometry(const FGeometry& AllottedGeometry) const;
+
+	/*Clear the follow target, removing it if it was only added to be followed*/
+	void StopFollowing();
+
+	TWeakObjectPtr<USceneCaptureComponentMap> Map;
+	const FMapStyle* MapStyle;
+	FSlateBrush MapBrush;
+	TSharedPtr<SMapMarkerLayer> MarkerLayer;
+	TArray<TWeakObjectPtr<USceneMapComponent>> Components;
+	TWeakObjectPtr<USceneMapComponent> FollowTarget;
+	/*Whether the follow target was only added to be followed*/
+	bool bFollowTargetAdded;
+	FVector2D ViewCenter;
+	FVector2D Size;
+	float Zoom;
+};
\ No newline at end of file
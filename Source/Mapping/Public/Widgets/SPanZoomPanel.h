@@ -8,6 +8,50 @@
 #include "MapWidgetStyle.h"
 #include "SlateDelegates.h"
 
+/*A pointer position in the local space of a SPanZoomPanel*/
+DECLARE_DELEGATE_OneParam(FOnPanZoomPointerEvent, const FVector2D& /*WidgetPosition*/);
+
+/*Data source of the virtualized items of a SPanZoomPanel*/
+DECLARE_DELEGATE_RetVal(int32, FOnGetPanZoomItemCount);
+DECLARE_DELEGATE_RetVal_OneParam(FVector2D, FOnGetPanZoomItemPosition, int32 /*ItemIndex*/);
+/*Widget for an item coming into view. RecycledWidget is a widget of an item that left the view, to be updated and returned instead of making a new one*/
+DECLARE_DELEGATE_RetVal_TwoParams(TSharedRef<SWidget>, FOnGeneratePanZoomItem, int32 /*ItemIndex*/, const TSharedPtr<SWidget>& /*RecycledWidget*/);
+DECLARE_DELEGATE_TwoParams(FOnReleasePanZoomItem, int32 /*ItemIndex*/, const TSharedRef<SWidget>& /*Widget*/);
+
+/*The zoom crossed into another band of a SPanZoomPanel. OldBand is INDEX_NONE for the first band after the bands were set, NewBand is INDEX_NONE once they are cleared*/
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnPanZoomBandChanged, int32 /*NewBand*/, int32 /*OldBand*/);
+
+/*A range of zoom content is shown at one level of detail for, from MinZoom up to the MinZoom of the next band*/
+struct FPanZoomBand
+{
+	FName Name;
+	float MinZoom;
+
+	FPanZoomBand()
+		: Name(NAME_None)
+		, MinZoom(0.0f)
+	{}
+
+	FPanZoomBand(FName InName, float InMinZoom)
+		: Name(InName)
+		, MinZoom(InMinZoom)
+	{}
+};
+
+/*Identifies a slot of a SPanZoomPanel. A handle goes stale when its slot is removed, and stale handles are rejected rather than followed*/
+struct MAPPING_API FPanZoomSlotHandle
+{
+	int32 Index;
+	uint32 Generation;
+
+	FPanZoomSlotHandle()
+		: Index(INDEX_NONE)
+		, Generation(0)
+	{}
+
+	FORCEINLINE bool IsSet() const { return Index != INDEX_NONE; }
+};
+
 class MAPPING_API SPanZoomPanel : public SPanel
 {
 public:
@@ -64,6 +108,7 @@ public:
 			, HAlignment(HAlign_Left)
 			, VAlignment(VAlign_Top)
 			, RenderOrder(1)
+			, ChildIndex(INDEX_NONE)
 		{ }
 
 		bool operator<(const FSlot& RHS) const
@@ -82,22 +127,60 @@ public:
 
 		FORCEINLINE bool GetClampedToBounds() const { return bClampToBounds; }		
 
+		FORCEINLINE int32 GetRenderOrder() const { return RenderOrder; }
+
+		/*Handle to remove this slot with later, unset for slots of virtualized items*/
+		FORCEINLINE const FPanZoomSlotHandle& GetHandle() const { return Handle; }
+
 	private:
+		friend class SPanZoomPanel;
+
 		TAttribute<FVector2D> SlotPosition;
 		TAttribute<FVector2D> SlotLocalScale;
 		bool bClampToBounds;
 		int32 RenderOrder;
+		/*Index in the children of the panel, kept by the panel so a slot is removed without a search*/
+		int32 ChildIndex;
+		FPanZoomSlotHandle Handle;
 	};
 
 	/** Slots and Slates**/
 	SLATE_BEGIN_ARGS(SPanZoomPanel)
 		: _MapStyle(&FMapStyle::GetDefault())
 		, _MinimumDesiredSize(FVector2D::ZeroVector)
+		, _ItemMargin(128.0f)
+		, _ItemOrder(1)
+		, _ZoomBandHysteresis(0.1f)
+		, _DirectManipulation(false)
+		, _PanPredictionTime(0.0f)
+		, _PanInertiaFriction(4.0f)
 	{
 	}
 		SLATE_ARGUMENT(FVector2D, MinimumDesiredSize)
 		SLATE_STYLE_ARGUMENT(FMapStyle, MapStyle)
 		SLATE_SUPPORTS_SLOT(SPanZoomPanel::FSlot)
+		/*The cursor moved over the panel while not panning, zooming or clicking*/
+		SLATE_EVENT(FOnPanZoomPointerEvent, OnPointerHovered)
+		/*A click or touch, or the click key which clicks the center of the panel*/
+		SLATE_EVENT(FOnPanZoomPointerEvent, OnPointerClicked)
+		SLATE_EVENT(FSimpleDelegate, OnPointerLeft)
+		/*Virtualized items, placed centered on their position in view space. Only items within ItemMargin of the view have a widget, generated
+		when they come into view and recycled when they leave, so widgets and arrange cost follow the view rather than the item count*/
+		SLATE_EVENT(FOnGetPanZoomItemCount, OnGetItemCount)
+		SLATE_EVENT(FOnGetPanZoomItemPosition, OnGetItemPosition)
+		SLATE_EVENT(FOnGeneratePanZoomItem, OnGenerateItem)
+		SLATE_EVENT(FOnReleasePanZoomItem, OnReleaseItem)
+		SLATE_ARGUMENT(float, ItemMargin)
+		/*Render order of every item slot*/
+		SLATE_ARGUMENT(int32, ItemOrder)
+		/*Bands by ascending MinZoom. The zoom has to pass a band edge by ZoomBandHysteresis to change band, so easing around an edge does not flicker*/
+		SLATE_ARGUMENT(TArray<FPanZoomBand>, ZoomBands)
+		SLATE_ARGUMENT(float, ZoomBandHysteresis)
+		/*Dragging with the right mouse button or the first finger moves the view with the pointer in the same frame instead of easing after it, and a release throws the view on with
+		the drag velocity decaying by PanInertiaFriction per second. PanPredictionTime leads the pointer by that many seconds of drag velocity*/
+		SLATE_ARGUMENT(bool, DirectManipulation)
+		SLATE_ARGUMENT(float, PanPredictionTime)
+		SLATE_ARGUMENT(float, PanInertiaFriction)
 
 	SLATE_END_ARGS()
 
@@ -110,17 +193,31 @@ public:
 		return *(new FSlot());
 	}
 
-	FSlot& AddSlot()
-	{
-		SPanZoomPanel::FSlot& NewSlot = *new FSlot();
-		Children.Add(&NewSlot);
-		Children.Sort(&FSlot::Sort);
-		return NewSlot;
-	}
+	/*Append a slot whose order is set afterwards. Children are sorted once at the end of the batch, or on the next tick outside one*/
+	FSlot& AddSlot();
+	/*Insert a slot behind every slot of the same or lower order, keeping the children sorted*/
+	FSlot& AddSlot(int32 InOrder);
+	/*Slots added until the matching EndBatch are sorted once. Batches nest*/
+	void BeginBatch();
+	void EndBatch();
+	/*Remove the slot of a handle from FSlot::GetHandle without searching for it, returns false if the handle is stale*/
+	bool RemoveSlot(const FPanZoomSlotHandle& Handle);
+	bool IsValid(const FPanZoomSlotHandle& Handle) const;
 	int32 RemoveSlot(const TSharedRef<SWidget>& SlotWidget);
 	void ClearChildren();
 	/** End Slots and Slate**/
 
+	/**Virtualized items**/
+
+	/*Read the item count and positions again on the next tick, after the data source changed*/
+	void RequestItemsRefresh();
+
+	/*Widget of an item if it is in view, null otherwise*/
+	TSharedPtr<SWidget> GetItemWidget(int32 ItemIndex) const;
+
+	FORCEINLINE int32 NumRealizedItems() const { return RealizedItems.Num(); }
+	FORCEINLINE int32 NumPooledItemWidgets() const { return ItemWidgetPool.Num(); }
+
 	/**Beg Widget Interface**/
 	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 
@@ -128,6 +225,8 @@ public:
 	virtual FReply OnMouseButtonUp(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
 
 	virtual FReply OnMouseMove(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
+	virtual void OnMouseLeave(const FPointerEvent& MouseEvent) override;
+	virtual void OnMouseCaptureLost() override;
 	virtual FReply OnMouseWheel(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
 
 	virtual FReply OnTouchGesture(const FGeometry& MyGeometry, const FPointerEvent& GestureEvent) override;
@@ -163,10 +262,14 @@ public:
 
 	virtual FVector2D ToWidgetPosition(const FVector2D& ViewPosition) const;
 	FVector2D ToViewPosition(const FVector2D& WidgetPosition) const;
+	FVector2D ToScreenPosition(const FVector2D& WidgetPosition) const;
 
 	float AngleToViewCenter(const FVector2D& Position, bool bIsInViewSpace) const;
 
-	/*Mutators*/
+	/*Whether pan or zoom are still easing to their targets. The view only changes while they do*/
+	bool IsViewAnimating() const;
+
+	/*Mutators. Pan and Zoom add to the input of the frame, which the next animation step applies at once however many events came in*/
 	void Pan(const FVector2D& PanAmountAndDirection);
 	void PanTo(const FVector2D& DesiredViewPosition);
 	void Zoom(float ZoomAmount);
@@ -177,6 +280,25 @@ public:
 	void SetZoomSpeed(float NewSpeed);
 	void SetPanSpeed(float NewSpeed);
 	void SetZoomRanges(float Min, float Max, const TArray<float>& Ranges);
+	void SetZoomBands(const TArray<FPanZoomBand>& Bands, float Hysteresis);
+	void SetDirectManipulation(bool bEnabled, float PredictionTime, float InertiaFriction);
+
+	/*Frames and seconds between the last measured pan input and the first paint that showed it*/
+	FORCEINLINE uint32 GetInputLatencyFrames() const { return InputLatencyFrames; }
+	FORCEINLINE float GetInputLatencySeconds() const { return InputLatencySeconds; }
+
+	/**Zoom bands**/
+
+	/*Band of the current zoom, INDEX_NONE without bands*/
+	FORCEINLINE int32 GetZoomBand() const { return ZoomBand; }
+	FName GetZoomBandName() const;
+	FORCEINLINE const TArray<FPanZoomBand>& GetZoomBands() const { return ZoomBands; }
+
+	/*Smallest zoom the view can reach inside a band*/
+	float GetZoomBandMinZoom(int32 Band) const;
+
+	/*Broadcast once per band change, for content to switch its level of detail instead of watching the zoom every frame*/
+	FORCEINLINE FOnPanZoomBandChanged& OnZoomBandChanged() { return ZoomBandChanged; }
 
 protected:
 	FGeometry LastTickGeometry;
@@ -238,6 +360,7 @@ protected:
 	virtual void HandlePan(const FGeometry& MyGeometry, const FAnalogInputEvent& InAnalogInputEvent);
 	virtual void HandleZoom(const FGeometry& MyGeometry, const FAnalogInputEvent& InAnalogInputEvent);
 	virtual void HandleClick(const FGeometry& MyGeometry, const FAnalogInputEvent& InAnalogInputEvent);
+	virtual void HandleHover(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent);
 
 	/*View methods*/
 	FSlateRect GetViewRect() const;
@@ -254,6 +377,13 @@ private:
 	bool bIsPanning;
 	bool bIsZooming;
 	bool bIsClicking;
+	/*Panning by mouse drag or touch, which direct manipulation follows 1:1*/
+	bool bIsDragging;
+
+	/*End a drag, throwing the view on in direct manipulation*/
+	void EndDrag();
+	/*Place the view at the dragged offset, or carry it on with the release velocity*/
+	void StepDirectPan(float DeltaTime);
 
 	struct
 	{
@@ -277,6 +407,15 @@ private:
 		FORCEINLINE void UpdateZoom(const float DeltaTime)
 		{
 			CurrentZoom = FMath::FInterpTo(CurrentZoom, ZoomToScale(), DeltaTime, ZoomSpeed);
+			if (IsSettled())
+			{
+				CurrentZoom = ZoomToScale();
+			}
+		}
+
+		FORCEINLINE bool IsSettled() const
+		{
+			return FMath::IsNearlyEqual(CurrentZoom, ZoomToScale(), 0.001f);
 		}
 
 		void Reset()
@@ -305,9 +444,18 @@ private:
 		FVector2D TargetViewOffset;
 		float PanSpeed;
 
-		FORCEINLINE float UpdatePan(const float DeltaTime)
+		FORCEINLINE void UpdatePan(const float DeltaTime)
 		{
 			CurrentViewOffset = FMath::Vector2DInterpTo(CurrentViewOffset, TargetViewOffset, DeltaTime, PanSpeed);
+			if (IsSettled())
+			{
+				CurrentViewOffset = TargetViewOffset;
+			}
+		}
+
+		FORCEINLINE bool IsSettled() const
+		{
+			return CurrentViewOffset.Equals(TargetViewOffset, 0.01f);
 		}
 
 		void Reset()
@@ -317,7 +465,105 @@ private:
 		}
 	} PanDriver;
 
+	/*Realize the items near the view and release those that left it*/
+	void UpdateRealizedItems();
+	void RebuildItemGrid();
+	void ReleaseItem(int32 RealizedIndex);
+
+	/*Ease pan and zoom on an active timer rather than every tick, registered by input and dropped once both settle*/
+	void StartViewAnimation();
+	EActiveTimerReturnType AnimateView(double InCurrentTime, float InDeltaTime);
+	/*Move the driver targets by the input accumulated since the last step*/
+	void ApplyPendingInput();
+	FVector2D PendingPan;
+	float PendingZoom;
+
+	bool bDirectManipulation;
+	float PanPredictionTime;
+	float PanInertiaFriction;
+	/*View units per second of the drag, and the view delta dragged since the last step*/
+	FVector2D PanVelocity;
+	FVector2D DragStepDelta;
+
+	/*One pan input at a time is followed from the event to the paint that shows it. Start to target is the move it caused.
+	A measurement is dropped when the target is moved elsewhere before the view gets there, or after MaxLatencyFrames*/
+	void CheckInputLatency() const;
+	void AbandonInputLatency() const;
+	mutable bool bLatencyInput;
+	mutable bool bLatencyApplied;
+	uint64 LatencyInputFrame;
+	double LatencyInputTime;
+	FVector2D LatencyStart;
+	FVector2D LatencyTarget;
+	mutable uint32 InputLatencyFrames;
+	mutable float InputLatencySeconds;
+	TWeakPtr<FActiveTimerHandle> ViewTimerHandle;
+
+	/*Move to the band of the current zoom, past the hysteresis unless bImmediate, and broadcast if it changed*/
+	void UpdateZoomBand(bool bImmediate);
+
+	TArray<FPanZoomBand> ZoomBands;
+	float ZoomBandHysteresis;
+	int32 ZoomBand;
+	FOnPanZoomBandChanged ZoomBandChanged;
+
+	/*Sort the children by render order if slots were appended, and refresh the child index of every slot from StartIndex on*/
+	void SortChildren();
+	void UpdateChildIndices(int32 StartIndex);
+
+	/*Give a slot a handle, and remove a child retiring its handle so it can no longer reach the freed slot*/
+	void AcquireSlotHandle(FSlot& Slot);
+	void RemoveChildAt(int32 ChildIndex);
+
+	struct FSlotHandleEntry
+	{
+		FSlot* Slot;
+		uint32 Generation;
+	};
+
+	TArray<FSlotHandleEntry> SlotHandles;
+	TArray<int32> FreeSlotHandles;
+
+	struct FRealizedItem
+	{
+		int32 ItemIndex;
+		FSlot* Slot;
+		uint32 LastVisit;
+	};
+
 	TPanelChildren<FSlot> Children;
+	/*Arranged children of the last paint, reset rather than rebuilt so its storage is kept at the high water mark*/
+	mutable FArrangedChildren PaintArrangedChildren;
+	bool bChildrenUnsorted;
+	int32 BatchDepth;
 	const FMapStyle* MapStyle;
+
+	FOnGetPanZoomItemCount OnGetItemCount;
+	FOnGetPanZoomItemPosition OnGetItemPosition;
+	FOnGeneratePanZoomItem OnGenerateItem;
+	FOnReleasePanZoomItem OnReleaseItem;
+	float ItemMargin;
+	int32 ItemOrder;
+	bool bItemsDirty;
+	uint32 ItemVisit;
+
+	/*Item positions bucketed into a uniform grid over their bounds, ItemCellStarts[Cell] to ItemCellStarts[Cell + 1] index into ItemCellItems*/
+	TArray<FVector2D> ItemPositions;
+	TArray<int32> ItemCellStarts;
+	TArray<int32> ItemCellItems;
+	FVector2D ItemGridOrigin;
+	FIntPoint ItemGridSize;
+	float ItemCellSize;
+	/*View bounds with the margin the realized items were last gathered for*/
+	FVector2D ItemQueryMin;
+	FVector2D ItemQueryMax;
+
+	TArray<FRealizedItem> RealizedItems;
+	TMap<int32, int32> RealizedIndices;
+	TArray<TSharedRef<SWidget>> ItemWidgetPool;
+	TArray<int32> ItemsInView;
+	FOnPanZoomPointerEvent OnPointerHovered;
+	FOnPanZoomPointerEvent OnPointerClicked;
+	FSimpleDelegate OnPointerLeft;
 	FVector2D MinimumDesiredSize;
 };
\ No newline at end of file